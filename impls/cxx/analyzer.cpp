@@ -0,0 +1,302 @@
+#include "analyzer.h"
+
+namespace {
+    bool is_dynamic(const Symbol* name) {
+        static const Symbol* const debug_eval = SymbolTable::intern("DEBUG-EVAL");
+        return name == debug_eval;
+    }
+
+    MalSymbol* head_symbol(MalList* list) {
+        const auto& elems = list->get_elem();
+        return elems.empty() ? nullptr : dyn_cast<MalSymbol>(elems[0]);
+    }
+
+    bool is_symbol_sequence(MalType* form) {
+        const auto sequence = dyn_cast<MalSequence>(form);
+        if (!sequence) {
+            return false;
+        }
+        for (const auto e: *sequence) {
+            if (!isa<MalSymbol>(e)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+Analyzer::Scope::Scope(Scope* parent) : parent_(parent) {}
+
+Analyzer::Scope* Analyzer::Scope::parent() const {
+    return this->parent_;
+}
+
+std::size_t Analyzer::Scope::find(const Symbol* name) const {
+    for (std::size_t i = 0; i < this->slots_.size(); ++i) {
+        if (this->slots_[i] == name) {
+            return i;
+        }
+    }
+    return npos;
+}
+
+bool Analyzer::Scope::is_bound(const std::size_t slot) const {
+    return this->bound_[slot];
+}
+
+std::size_t Analyzer::Scope::declare(const Symbol* name, const bool bound) {
+    this->slots_.push_back(name);
+    this->bound_.push_back(bound);
+    return this->slots_.size() - 1;
+}
+
+MalType* Analyzer::analyze(MalType* form) {
+    return analyze(form, nullptr);
+}
+
+MalType* Analyzer::resolve(MalSymbol* symbol, Scope* scope, std::size_t depth) {
+    if (is_dynamic(symbol->id())) {
+        return symbol;
+    }
+    for (; scope; scope = scope->parent(), ++depth) {
+        if (const auto slot = scope->find(symbol->id()); slot != Scope::npos) {
+            MalType* fallback = scope->is_bound(slot) ? nullptr : resolve(symbol, scope->parent(), depth + 1);
+            return new MalLocal(symbol, depth, slot, fallback);
+        }
+    }
+    return symbol;
+}
+
+bool Analyzer::analyze_all(std::span<MalType* const> forms, std::vector<MalType*>& out,
+                           Scope* scope, const bool quasi) {
+    bool changed = false;
+    out.reserve(forms.size());
+    for (const auto form: forms) {
+        MalType* analyzed = quasi ? analyze_quasi(form, scope) : analyze(form, scope);
+        changed = changed || analyzed != form;
+        out.emplace_back(analyzed);
+    }
+    return changed;
+}
+
+MalType* Analyzer::analyze(MalType* form, Scope* scope) {
+    switch (form->kind()) {
+        case MalKind::Symbol:
+            return resolve(cast<MalSymbol>(form), scope, 0);
+
+        case MalKind::List: {
+            const auto lst = cast<MalList>(form);
+            const auto& elems = lst->get_elem();
+            std::size_t first = 0;
+            if (const auto head = head_symbol(lst)) {
+                switch (head->special()) {
+                    case SpecialForm::Quote:
+                        return form;
+                    case SpecialForm::QuasiQuote: {
+                        if (elems.size() != 2) {
+                            return form;
+                        }
+                        MalType* tmpl = analyze_quasi(elems[1], scope);
+                        return tmpl == elems[1] ? form : new MalList{head, tmpl};
+                    }
+                    case SpecialForm::Fn:
+                        return analyze_fn(lst, scope);
+                    case SpecialForm::Let:
+                        return analyze_let(lst, scope);
+                    case SpecialForm::Def:
+                        return analyze_def(lst, scope);
+                    case SpecialForm::Do:
+                    case SpecialForm::If:
+                    case SpecialForm::UnQuote:
+                    case SpecialForm::SpliceUnQuote:
+                        first = 1;
+                        break;
+                    case SpecialForm::None:
+                        break;
+                }
+            }
+            std::vector<MalType*> analyzed(elems.begin(), elems.begin() + static_cast<std::ptrdiff_t>(first));
+            return analyze_all(elems.subspan(first), analyzed, scope) ? new MalList(analyzed) : form;
+        }
+
+        case MalKind::Vector: {
+            const auto vec = cast<MalVector>(form);
+            std::vector<MalType*> analyzed;
+            return analyze_all(vec->to_vector(), analyzed, scope) ? new MalVector(analyzed) : form;
+        }
+
+        case MalKind::Map: {
+            const auto map = cast<MalMap>(form);
+            bool changed = false;
+            Hamt analyzed;
+            for (const auto pair: map->get_elem()) {
+                MalType* value = analyze(pair->value(), scope);
+                changed = changed || value != pair->value();
+                analyzed = analyzed.assoc(value == pair->value() ? pair : new MalPair(pair->key(), value));
+            }
+            return changed ? new MalMap(analyzed) : form;
+        }
+
+        case MalKind::Deref: {
+            const auto deref = cast<MalDeref>(form);
+            MalType* expr = analyze(deref->get(), scope);
+            return expr == deref->get() ? form : new MalDeref(expr);
+        }
+
+        case MalKind::QuasiQuote: {
+            const auto quasi = cast<MalQuasiQuote>(form);
+            MalType* tmpl = analyze_quasi(quasi->get(), scope);
+            return tmpl == quasi->get() ? form : new MalQuasiQuote(tmpl);
+        }
+
+        default:
+            return form;
+    }
+}
+
+MalType* Analyzer::analyze_quasi(MalType* form, Scope* scope) {
+    if (const auto unquote = dyn_cast<MalUnQuote>(form)) {
+        MalType* expr = analyze(unquote->get(), scope);
+        return expr == unquote->get() ? form : new MalUnQuote(expr);
+    }
+
+    if (const auto splice = dyn_cast<MalUnQuoteSplicing>(form)) {
+        MalType* expr = analyze(splice->get(), scope);
+        return expr == splice->get() ? form : new MalUnQuoteSplicing(expr);
+    }
+
+    if (const auto lst = dyn_cast<MalList>(form)) {
+        const auto& elems = lst->get_elem();
+        if (const auto head = head_symbol(lst);
+            head && elems.size() == 2 &&
+            (head->special() == SpecialForm::UnQuote || head->special() == SpecialForm::SpliceUnQuote)) {
+            MalType* expr = analyze(elems[1], scope);
+            return expr == elems[1] ? form : new MalList{head, expr};
+        }
+        std::vector<MalType*> analyzed;
+        return analyze_all(elems, analyzed, scope, true) ? new MalList(analyzed) : form;
+    }
+
+    if (const auto vec = dyn_cast<MalVector>(form)) {
+        std::vector<MalType*> analyzed;
+        return analyze_all(vec->to_vector(), analyzed, scope, true) ? new MalVector(analyzed) : form;
+    }
+
+    return form;
+}
+
+MalType* Analyzer::analyze_fn(MalList* form, Scope* scope) {
+    static const Symbol* const rest_marker = SymbolTable::intern("&");
+    const auto& elems = form->get_elem();
+    if (elems.size() != 3 || !is_symbol_sequence(elems[1])) {
+        return form;
+    }
+
+    Scope fn_scope(scope);
+    for (const auto param: *cast<MalSequence>(elems[1])) {
+        if (const auto id = cast<MalSymbol>(param)->id(); id != rest_marker) {
+            fn_scope.declare(id, true);
+        }
+    }
+    collect_defs(elems[2], fn_scope);
+
+    MalType* body = analyze(elems[2], &fn_scope);
+    return new MalList{elems[0], elems[1], body};
+}
+
+MalType* Analyzer::analyze_let(MalList* form, Scope* scope) {
+    const auto& elems = form->get_elem();
+    if (elems.size() != 3 || !isa<MalSequence>(elems[1])) {
+        return form;
+    }
+    const auto bindings = dyn_cast<MalSequence>(elems[1]);
+    const auto binding_elems = bindings->to_vector();
+    if (binding_elems.size() % 2 != 0) {
+        return form;
+    }
+    for (std::size_t i = 0; i < binding_elems.size(); i += 2) {
+        if (!isa<MalSymbol>(binding_elems[i])) {
+            return form;
+        }
+    }
+
+    Scope let_scope(scope);
+    for (std::size_t i = 0; i < binding_elems.size(); i += 2) {
+        if (const auto id = cast<MalSymbol>(binding_elems[i])->id();
+            !is_dynamic(id) && let_scope.find(id) == Scope::npos) {
+            let_scope.declare(id, false);
+        }
+    }
+    for (std::size_t i = 1; i < binding_elems.size(); i += 2) {
+        collect_defs(binding_elems[i], let_scope);
+    }
+    collect_defs(elems[2], let_scope);
+
+    std::vector<MalType*> analyzed_bindings;
+    analyzed_bindings.reserve(binding_elems.size());
+    for (std::size_t i = 0; i < binding_elems.size(); i += 2) {
+        const auto name = dyn_cast<MalSymbol>(binding_elems[i]);
+        analyzed_bindings.emplace_back(is_dynamic(name->id())
+            ? static_cast<MalType*>(name)
+            : new MalLocal(name, 0, let_scope.find(name->id())));
+        analyzed_bindings.emplace_back(analyze(binding_elems[i + 1], &let_scope));
+    }
+    MalType* analyzed_sequence = dyn_cast<MalVector>(bindings)
+        ? static_cast<MalType*>(new MalVector(analyzed_bindings))
+        : new MalList(analyzed_bindings);
+    MalType* body = analyze(elems[2], &let_scope);
+    return new MalList{elems[0], analyzed_sequence, body};
+}
+
+MalType* Analyzer::analyze_def(MalList* form, Scope* scope) {
+    const auto& elems = form->get_elem();
+    if (elems.size() != 3 || !isa<MalSymbol>(elems[1])) {
+        return form;
+    }
+
+    const auto name = dyn_cast<MalSymbol>(elems[1]);
+    MalType* value = analyze(elems[2], scope);
+    if (!scope || is_dynamic(name->id())) {
+        return value == elems[2] ? form : new MalList{elems[0], name, value};
+    }
+
+    auto slot = scope->find(name->id());
+    if (slot == Scope::npos) {
+        slot = scope->declare(name->id(), false);
+    }
+    return new MalList{elems[0], new MalLocal(name, 0, slot), value};
+}
+
+void Analyzer::collect_defs(MalType* form, Scope& scope) {
+    if (const auto lst = dyn_cast<MalList>(form)) {
+        const auto& elems = lst->get_elem();
+        if (const auto head = head_symbol(lst)) {
+            const auto special = head->special();
+            if (special == SpecialForm::Quote || special == SpecialForm::QuasiQuote ||
+                special == SpecialForm::Fn || special == SpecialForm::Let) {
+                return;
+            }
+            if (special == SpecialForm::Def && elems.size() == 3) {
+                if (const auto target = dyn_cast<MalSymbol>(elems[1]);
+                    target && !is_dynamic(target->id()) && scope.find(target->id()) == Scope::npos) {
+                    scope.declare(target->id(), false);
+                }
+                collect_defs(elems[2], scope);
+                return;
+            }
+        }
+        for (const auto e: elems) {
+            collect_defs(e, scope);
+        }
+    } else if (const auto vec = dyn_cast<MalVector>(form)) {
+        for (const auto e: *vec) {
+            collect_defs(e, scope);
+        }
+    } else if (const auto map = dyn_cast<MalMap>(form)) {
+        for (const auto pair: map->get_elem()) {
+            collect_defs(pair->value(), scope);
+        }
+    } else if (const auto deref = dyn_cast<MalDeref>(form)) {
+        collect_defs(deref->get(), scope);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include <span>
+#include <vector>
+#include "types.h"
+
+class Analyzer {
+    class Scope {
+        Scope* parent_;
+        std::vector<const Symbol*> slots_;
+        std::vector<bool> bound_;
+    public:
+        constexpr static std::size_t npos = static_cast<std::size_t>(-1);
+
+        explicit Scope(Scope* parent);
+        [[nodiscard]] Scope* parent() const;
+        [[nodiscard]] std::size_t find(const Symbol* name) const;
+        [[nodiscard]] bool is_bound(std::size_t slot) const;
+        std::size_t declare(const Symbol* name, bool bound);
+    };
+
+    static MalType* analyze(MalType* form, Scope* scope);
+    static MalType* analyze_quasi(MalType* form, Scope* scope);
+    static MalType* analyze_fn(MalList* form, Scope* scope);
+    static MalType* analyze_let(MalList* form, Scope* scope);
+    static MalType* analyze_def(MalList* form, Scope* scope);
+    static bool analyze_all(std::span<MalType* const> forms, std::vector<MalType*>& out,
+                            Scope* scope, bool quasi = false);
+    static MalType* resolve(MalSymbol* symbol, Scope* scope, std::size_t depth);
+    static void collect_defs(MalType* form, Scope& scope);
+public:
+    static MalType* analyze(MalType* form);
+};
+
+#endif //ANALYZER_H
@@ -0,0 +1,55 @@
+#include <iostream>
+#include <string>
+#include "bench_util.h"
+#include "gc.h"
+#include "reader.h"
+
+namespace {
+    constexpr int form_count = 400;
+    constexpr int discard_rounds = 10;
+
+    // A nested definition of the shape rule files are made of; read-string style callers parse and drop it.
+    std::string make_form(const int i) {
+        const auto n = std::to_string(i);
+        return "(def! rule-" + n + " (fn* [x ys] (let* [a (list x ys :k-" + n + ") b [a a \"s\"]] "
+               "(if (= x nil) {:a a :b b} (cons x (rest ys))))))";
+    }
+
+}
+
+int main() {
+    std::string source = "(do ";
+    for (int i = 0; i < form_count; ++i) {
+        source += make_form(i);
+    }
+    source += ")";
+
+    const auto startup_objects = GC::stats().heap_objects;
+    MalType* form = nullptr;
+    GC::add_root(&form);
+    const double read = bench::ms([&] { form = Reader::read_str(source); });
+    const auto live_objects = GC::stats().heap_objects - startup_objects;
+    form = nullptr;
+    const double sweep = bench::ms([] { GC::collect(); });
+    // Interned keywords stay behind; everything else the reader made is gone.
+    const auto baseline_objects = GC::stats().heap_objects;
+
+    double churn = 0;
+    for (int round = 0; round < discard_rounds; ++round) {
+        for (int i = 0; i < form_count; ++i) {
+            Reader::read_str(make_form(i));
+        }
+        churn += bench::ms([] { GC::collect(); });
+    }
+
+    if (GC::stats().heap_objects != baseline_objects) {
+        std::cerr << GC::stats().heap_objects - baseline_objects << " objects survived the last collection\n";
+        return 1;
+    }
+
+    std::cout << source.size() / 1024 << " KiB form, " << live_objects << " objects\n";
+    std::cout << "read_str:                            " << read << " ms\n";
+    std::cout << "collect once it is garbage:          " << sweep << " ms\n";
+    std::cout << "collect after " << form_count << " discarded read_str:  " << churn / discard_rounds << " ms\n";
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <chrono>
+#include <iostream>
+#include <string_view>
+
+// Timing and self-check helpers shared by the benches in this directory.
+namespace bench {
+    // Wall-clock milliseconds one call of f takes.
+    template <typename F>
+    double ms(F&& f) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    // Mean nanoseconds per call of f over the given number of calls.
+    template <typename F>
+    double ns_per_op(const int iterations, F&& f) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            f();
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / iterations;
+    }
+
+    // A bench compares two ways of computing the same thing; timings mean nothing if the results differ.
+    // Reports the mismatch and returns false so main can bail out with a failing status.
+    inline bool agree(const bool same, const std::string_view what) {
+        if (!same) {
+            std::cerr << what << " disagree\n";
+        }
+        return same;
+    }
+}
+
+#endif //BENCH_UTIL_H
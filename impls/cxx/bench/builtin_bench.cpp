@@ -0,0 +1,47 @@
+#include <functional>
+#include <iostream>
+#include <span>
+#include "bench_util.h"
+#include "builtin.h"
+#include "error.h"
+
+namespace {
+    constexpr int call_count = 5'000'000;
+
+    // How builtins were called before the descriptor table: type-erased, with the arity checked inside.
+    MalType* legacy_less(const std::span<MalType* const> args) {
+        if (args.size() != 2) {
+            throw argInvalidError("expected 2 args, given " + std::to_string(args.size()) + " arg(s)");
+        }
+        return less(args[0], args[1]);
+    }
+
+}
+
+int main() {
+    MalType* const args[] = {MalInt::of(1), MalInt::of(2)};
+    const std::span<MalType* const> arg_span(args);
+
+    const std::function<MalType*(std::span<MalType* const>)> legacy = legacy_less;
+    int legacy_true = 0;
+    const double legacy_ms = bench::ms([&] {
+        for (int i = 0; i < call_count; ++i) legacy_true += legacy(arg_span) == MalBool::instance(true);
+    });
+
+    const Builtin* builtin = nullptr;
+    for (const auto& entry: builtins()) {
+        if (std::string_view(entry.name) == "<") builtin = &entry;
+    }
+    int table_true = 0;
+    const double table_ms = bench::ms([&] {
+        for (int i = 0; i < call_count; ++i) table_true += builtin->call(arg_span) == MalBool::instance(true);
+    });
+
+    if (!bench::agree(legacy_true == table_true, "dispatch results")) {
+        return 1;
+    }
+    std::cout << call_count << " calls of (< 1 2)\n";
+    std::cout << "std::function:            " << legacy_ms << " ms\n";
+    std::cout << "builtin table:            " << table_ms << " ms\n";
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include "bench_util.h"
+#include "env.h"
+#include "evaluator.h"
+#include "reader.h"
+
+namespace {
+    // A collected loop settles at a fixed heap; anything an iteration leaks, or hides from the collection
+    // trigger, adds up well past this.
+    constexpr long max_growth_kib = 4 * 1024;
+
+    struct LoopCase {
+        // Evaluated once per iteration, with n bound to the iteration count left.
+        const char* body;
+        int iterations;
+    };
+
+    constexpr LoopCase loop_cases[] = {
+        {"[n n]", 1'000'000},
+        {"{:a n :b n}", 1'000'000},
+        // Each string owns a 26 KiB buffer outside the object, which the collector has to count.
+        {"(str big big)", 20'000},
+    };
+
+    long resident_kib() {
+        std::ifstream statm("/proc/self/statm");
+        long size = 0;
+        long resident = 0;
+        statm >> size >> resident;
+        return resident * (::sysconf(_SC_PAGESIZE) / 1024);
+    }
+
+    // Runs the loop once to warm up, then again, and checks resident memory stayed flat over the second run.
+    bool run_loop(const std::string& engine, const LoopCase& loop, Env& global_env) {
+        Evaluator::select_engine("--engine=" + engine);
+        Evaluator::eval(Reader::read_str("(def! loop (fn* [n acc] (if (= n 0) acc (loop (- n 1) " +
+                                         std::string(loop.body) + "))))"), &global_env);
+        const auto run = [&](const int iterations) {
+            Evaluator::eval(Reader::read_str("(loop " + std::to_string(iterations) + " nil)"), &global_env);
+        };
+        run(loop.iterations / 5);
+        const long before = resident_kib();
+        const double elapsed = bench::ms([&] { run(loop.iterations); });
+        const long growth = resident_kib() - before;
+
+        std::cout << loop.iterations << " x " << loop.body << ", " << engine << ": " << elapsed << " ms, resident +"
+                  << growth << " KiB\n";
+        return bench::agree(growth < max_growth_kib, engine + " memory before and after " + loop.body + " loops");
+    }
+}
+
+int main() {
+    Env global_env;
+    Evaluator::set_env(&global_env);
+    Evaluator::eval(Reader::read_str("(def! big (str \"" + std::string(1024, 'x') + "\"))"), &global_env);
+    Evaluator::eval(Reader::read_str("(def! big (str big big big big big big big big big big big big big))"),
+                    &global_env);
+
+    bool ok = true;
+    for (const auto& loop: loop_cases) {
+        for (const std::string engine: {"tree", "vm"}) {
+            ok = run_loop(engine, loop, global_env) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
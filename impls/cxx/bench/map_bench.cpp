@@ -0,0 +1,80 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bench_util.h"
+#include "gc.h"
+#include "types.h"
+
+namespace {
+    constexpr int key_count = 4'000;
+    constexpr int large_key_length = 10'000;
+    constexpr int large_key_lookups = 10'000;
+
+    // How MalMap::put behaved over a std::set ordered by address: scan every entry with equal().
+    void legacy_put(std::vector<MalPair*>& entries, MalType* key, MalType* value) {
+        for (const auto entry: entries) {
+            if (entry->key()->equal(key)) {
+                entry->setValue(value);
+                return;
+            }
+        }
+        entries.push_back(new MalPair(key, value));
+    }
+
+}
+
+int main() {
+    std::vector<MalType*> keys;
+    for (int i = 0; i < key_count; ++i) {
+        keys.push_back(MalKeyword::intern("config-key-" + std::to_string(i)));
+    }
+    GC::add_root(&keys);
+
+    std::vector<MalPair*> legacy;
+    const double legacy_build = bench::ms([&] {
+        for (const auto key: keys) legacy_put(legacy, key, key);
+    });
+
+    MalType* map = new MalMap;
+    GC::add_root(&map);
+    const double hamt_build = bench::ms([&] {
+        for (const auto key: keys) cast<MalMap>(map)->put(key, key);
+    });
+
+    std::size_t found = 0;
+    const double hamt_lookup = bench::ms([&] {
+        for (const auto key: keys) found += cast<MalMap>(map)->get(MalKeyword::intern(cast<MalKeyword>(key)->name())) == key;
+    });
+
+    MalType* smaller = map;
+    GC::add_root(&smaller);
+    const double hamt_dissoc = bench::ms([&] {
+        for (std::size_t i = 0; i < keys.size(); i += 2) smaller = cast<MalMap>(smaller)->dissoc(keys[i]);
+    });
+
+    // A collection key hashes its elements once; later lookups reuse the cached hash.
+    std::vector<MalType*> elements;
+    for (int i = 0; i < large_key_length; ++i) {
+        elements.push_back(new MalInt(i));
+    }
+    MalType* large_key = new MalVector(elements);
+    GC::add_root(&large_key);
+    cast<MalMap>(map)->put(large_key, large_key);
+    int large_found = 0;
+    const double large_lookup = bench::ms([&] {
+        for (int i = 0; i < large_key_lookups; ++i) large_found += cast<MalMap>(map)->get(large_key) == large_key;
+    });
+
+    if (!bench::agree(large_found == large_key_lookups && found == keys.size() && cast<MalMap>(map)->size() == keys.size() + 1 &&
+                      cast<MalMap>(smaller)->size() == keys.size() / 2 && cast<MalMap>(smaller)->get(keys[1]) &&
+                      !cast<MalMap>(smaller)->get(keys[0]), "map contents")) {
+        return 1;
+    }
+
+    std::cout << key_count << " keyword keys, linear put:  " << legacy_build << " ms\n";
+    std::cout << key_count << " keyword keys, HAMT put:    " << hamt_build << " ms\n";
+    std::cout << key_count << " lookups by equal key:      " << hamt_lookup << " ms\n";
+    std::cout << key_count / 2 << " persistent dissocs:        " << hamt_dissoc << " ms\n";
+    std::cout << large_key_lookups << " lookups of a " << large_key_length << "-element vector key: " << large_lookup << " ms\n";
+    return 0;
+}
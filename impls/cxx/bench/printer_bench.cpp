@@ -0,0 +1,91 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "bench_util.h"
+#include "gc.h"
+#include "printer.h"
+
+namespace {
+    constexpr int row_count = 50'000;
+    constexpr int nesting_depth = 2'000;
+
+    // How printing worked before the streaming printer: every structure built its own string and its parent
+    // copied it, so each character is copied once per enclosing level.
+    std::string nested_to_string(const MalType* value) {
+        std::stringstream ss;
+        if (const auto sequence = dyn_cast<MalSequence>(value)) {
+            ss << (isa<MalList>(value) ? "(" : "[");
+            bool first = true;
+            for (const auto element: *sequence) {
+                if (!first) {
+                    ss << " ";
+                }
+                ss << nested_to_string(element);
+                first = false;
+            }
+            ss << (isa<MalList>(value) ? ")" : "]");
+        } else if (const auto map = dyn_cast<MalMap>(value)) {
+            ss << "{";
+            bool first = true;
+            for (const auto entry: map->get_elem()) {
+                if (!first) {
+                    ss << " ";
+                }
+                ss << nested_to_string(entry->key()) << " " << nested_to_string(entry->value());
+                first = false;
+            }
+            ss << "}";
+        } else {
+            ss << value->to_string(true);
+        }
+        return ss.str();
+    }
+
+    // Rows of small maps: wide and shallow, like a data file.
+    MalType* make_rows() {
+        std::vector<MalType*> rows;
+        for (int i = 0; i < row_count; ++i) {
+            Hamt row;
+            row = row.assoc(new MalPair{MalKeyword::intern("id"), MalInt::of(i)});
+            row = row.assoc(new MalPair{MalKeyword::intern("name"), new MalString("row \"" + std::to_string(i) + "\"")});
+            row = row.assoc(new MalPair{MalKeyword::intern("tags"), new MalVector({MalKeyword::intern("a"), MalInt::of(i % 7)})});
+            rows.push_back(new MalMap(row));
+        }
+        return new MalVector(rows);
+    }
+
+    // A narrow structure nested deeply, where nested copying is quadratic.
+    MalType* make_nested() {
+        MalType* value = new MalList{MalInt::of(0)};
+        for (int i = 1; i < nesting_depth; ++i) {
+            value = new MalList{MalInt::of(i), value};
+        }
+        return value;
+    }
+
+}
+
+int main() {
+    MalType* rows = make_rows();
+    MalType* nested = make_nested();
+    GC::add_root(&rows);
+    GC::add_root(&nested);
+
+    std::string legacy_rows, legacy_nested, streamed_rows, streamed_nested;
+    const double legacy_rows_ms = bench::ms([&] { legacy_rows = nested_to_string(rows); });
+    const double streamed_rows_ms = bench::ms([&] { streamed_rows = Printer::pr_str(rows); });
+    const double legacy_nested_ms = bench::ms([&] { legacy_nested = nested_to_string(nested); });
+    const double streamed_nested_ms = bench::ms([&] { streamed_nested = Printer::pr_str(nested); });
+    if (!bench::agree(legacy_rows == streamed_rows && legacy_nested == streamed_nested, "printed forms")) {
+        return 1;
+    }
+
+    std::cout << row_count << " map rows, " << streamed_rows.size() / 1024 << " KiB printed\n";
+    std::cout << "nested stringstreams:     " << legacy_rows_ms << " ms\n";
+    std::cout << "streaming printer:        " << streamed_rows_ms << " ms\n";
+    std::cout << "list nested " << nesting_depth << " deep, " << streamed_nested.size() / 1024 << " KiB printed\n";
+    std::cout << "nested stringstreams:     " << legacy_nested_ms << " ms\n";
+    std::cout << "streaming printer:        " << streamed_nested_ms << " ms\n";
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+#include "bench_util.h"
+#include "gc.h"
+#include "reader.h"
+
+namespace {
+    constexpr std::size_t source_bytes = 2 << 20;
+    constexpr std::size_t numbers_bytes = 256 << 10;
+    constexpr int scan_rounds = 3;
+
+    // The std::regex tokenizer Reader used before the hand-written scanner, kept as the reference.
+    std::vector<std::string> regex_tokenize(const std::string& input) {
+        static const std::regex pattern(R"([\s,]*(~@|[\[\]{}()'`~^@]|"(?:\\.|[^\\"])*"?|;.*|[^\s\[\]{}('"`,;)]*))");
+        std::vector<std::string> tokens;
+        for (auto it = std::sregex_iterator(input.begin(), input.end(), pattern); it != std::sregex_iterator(); ++it) {
+            std::string token = it->str();
+            token.erase(0, token.find_first_not_of(" \t\n\r,"));
+            token.erase(token.find_last_not_of(" \t\n\r,") + 1);
+            if (!token.empty() && token[0] != ';') {
+                tokens.emplace_back(token);
+            }
+        }
+        return tokens;
+    }
+
+    // Rule-file shaped source: definitions over maps, vectors, strings with escapes, quotes and comments.
+    std::string make_source() {
+        std::string source = "(do\n";
+        for (int i = 0; source.size() < source_bytes; ++i) {
+            const auto n = std::to_string(i);
+            source += ";; rule " + n + "\n";
+            source += "(def! rule-" + n + " {:id " + n + " :name \"rule \\\"" + n + "\\\"\\n\" :weight -" + n +
+                      ", :tags [:a :b :c] :when '(> x " + n + ") :then `(f ~x ~@ys @state)})\n";
+        }
+        return source + "nil)\n";
+    }
+
+    // Data-file shaped source: rows of integers, which read_atom once matched against a freshly built regex.
+    std::string make_numbers() {
+        std::string source = "[\n";
+        for (int i = 0; source.size() < numbers_bytes; ++i) {
+            source += "[" + std::to_string(i) + " -" + std::to_string(i * 7919) + " " + std::to_string(i % 97) + "]\n";
+        }
+        return source + "]\n";
+    }
+
+    // What classifying a token cost before the one-pass classifier: a regex compiled per token, then stoll.
+    int64_t regex_classify(const std::vector<std::string_view>& tokens) {
+        int64_t sum = 0;
+        for (const auto token: tokens) {
+            if (std::regex_match(token.begin(), token.end(), std::regex("^[-+]?[0-9]{1,19}$"))) {
+                sum += std::stoll(std::string(token));
+            }
+        }
+        return sum;
+    }
+
+    template <typename F>
+    double mb_per_s(const std::size_t bytes, const int rounds, F&& f) {
+        double best = 0;
+        for (int round = 0; round < rounds; ++round) {
+            const auto start = std::chrono::steady_clock::now();
+            f();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::max(best, static_cast<double>(bytes) / (1 << 20) / elapsed.count());
+        }
+        return best;
+    }
+}
+
+int main() {
+    const std::string source = make_source();
+
+    std::vector<std::string> legacy;
+    std::vector<std::string_view> tokens;
+    const double legacy_rate = mb_per_s(source.size(), scan_rounds, [&] { legacy = regex_tokenize(source); });
+    const double scanner_rate = mb_per_s(source.size(), scan_rounds, [&] { tokens = Reader::tokenize(source); });
+    if (!bench::agree(std::equal(legacy.begin(), legacy.end(), tokens.begin(), tokens.end()), "token streams")) {
+        return 1;
+    }
+
+    MalType* form = nullptr;
+    GC::add_root(&form);
+    const double read_rate = mb_per_s(source.size(), 1, [&] { form = Reader::read_str(source); });
+
+    const std::string numbers = make_numbers();
+    const auto number_tokens = Reader::tokenize(numbers);
+    int64_t classified = 0;
+    const double regex_classify_rate = mb_per_s(numbers.size(), 1, [&] { classified = regex_classify(number_tokens); });
+    const double numbers_read_rate = mb_per_s(numbers.size(), scan_rounds, [&] { form = Reader::read_str(numbers); });
+    int64_t read_sum = 0;
+    for (const auto row: *cast<MalVector>(form)) {
+        for (const auto n: *cast<MalVector>(row)) {
+            read_sum += cast<MalInt>(n)->get_elem();
+        }
+    }
+    if (!bench::agree(read_sum == classified, "integer values")) {
+        return 1;
+    }
+
+    std::cout << source.size() / 1024 << " KiB source, " << tokens.size() << " tokens\n";
+    std::cout << "std::regex tokenizer:     " << legacy_rate << " MB/s\n";
+    std::cout << "hand-written tokenizer:   " << scanner_rate << " MB/s\n";
+    std::cout << "Reader::read_str to AST:  " << read_rate << " MB/s\n";
+    std::cout << numbers.size() / 1024 << " KiB of integer rows, " << number_tokens.size() << " tokens\n";
+    std::cout << "per-token regex classify: " << regex_classify_rate << " MB/s\n";
+    std::cout << "Reader::read_str to AST:  " << numbers_read_rate << " MB/s\n";
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "bench_util.h"
+#include "gc.h"
+#include "types.h"
+
+namespace {
+    constexpr int element_count = 20'000;
+    constexpr int64_t expected_sum = static_cast<int64_t>(element_count) * (element_count - 1) / 2;
+
+    // How conj and cons had to work when MalVector and MalList wrapped a std::vector: copy every element into a
+    // new vector, with the new one at the back or the front.
+    std::vector<MalType*> copying_build(const bool at_front, double& elapsed) {
+        std::vector<MalType*> flat;
+        elapsed = bench::ms([&] {
+            for (int i = 0; i < element_count; ++i) {
+                std::vector<MalType*> next;
+                next.reserve(flat.size() + 1);
+                if (at_front) next.push_back(MalInt::of(i));
+                next.insert(next.end(), flat.begin(), flat.end());
+                if (!at_front) next.push_back(MalInt::of(i));
+                flat = std::move(next);
+            }
+        });
+        return flat;
+    }
+
+    // Times nth over every index and a plain walk of the sequence, checking both see every element.
+    template <typename Seq>
+    bool time_reads(MalType* const& sequence, const std::string_view name) {
+        int64_t indexed = 0;
+        const double nth_ms = bench::ms([&] {
+            for (std::size_t i = 0; i < element_count; ++i) indexed += cast<MalInt>(cast<Seq>(sequence)->nth(i))->get_elem();
+        });
+        int64_t iterated = 0;
+        const double walk_ms = bench::ms([&] {
+            for (const auto e: *cast<Seq>(sequence)) iterated += cast<MalInt>(e)->get_elem();
+        });
+        if (!bench::agree(indexed == expected_sum && iterated == expected_sum &&
+                          cast<Seq>(sequence)->size() == element_count, std::string(name) + " reads")) {
+            return false;
+        }
+        std::cout << element_count << " " << name << " nth lookups:          " << nth_ms << " ms\n";
+        std::cout << "iterate " << element_count << " " << name << " elements:   " << walk_ms << " ms\n";
+        return true;
+    }
+
+    bool vector_bench() {
+        double flat_append = 0;
+        const auto flat = copying_build(false, flat_append);
+
+        MalType* vector = new MalVector(std::vector<MalType*>{});
+        GC::add_root(&vector);
+        const double trie_append = bench::ms([&] {
+            for (int i = 0; i < element_count; ++i) vector = cast<MalVector>(vector)->conj(MalInt::of(i));
+        });
+        std::cout << element_count << " appends, copying std::vector:  " << flat_append << " ms\n";
+        std::cout << element_count << " appends, persistent trie:      " << trie_append << " ms\n";
+        if (!time_reads<MalVector>(vector, "vector")) return false;
+
+        MalType* updated = vector;
+        GC::add_root(&updated);
+        const double trie_assoc = bench::ms([&] {
+            for (std::size_t i = 0; i < element_count; i += 7) updated = cast<MalVector>(updated)->assoc(i, MalNil::instance());
+        });
+        if (!bench::agree(isa<MalInt>(cast<MalVector>(vector)->nth(7)) && isa<MalNil>(cast<MalVector>(updated)->nth(7)) &&
+                          vector->equal(new MalVector(flat)), "vector contents")) {
+            return false;
+        }
+        std::cout << element_count / 7 + 1 << " persistent updates:             " << trie_assoc << " ms\n";
+        return true;
+    }
+
+    bool list_bench() {
+        double flat_cons = 0;
+        const auto flat = copying_build(true, flat_cons);
+
+        MalType* list = new MalList{};
+        GC::add_root(&list);
+        const double chunked_cons = bench::ms([&] {
+            for (int i = 0; i < element_count; ++i) list = MalList::cons(MalInt::of(i), cast<MalList>(list));
+        });
+        std::cout << element_count << " conses, copying std::vector:   " << flat_cons << " ms\n";
+        std::cout << element_count << " conses, chunked list:          " << chunked_cons << " ms\n";
+
+        int64_t walked = 0;
+        const double rest_walk = bench::ms([&] {
+            for (auto l = cast<MalList>(list); !l->empty(); l = l->rest()) walked += cast<MalInt>(l->nth(0))->get_elem();
+        });
+        if (!bench::agree(walked == expected_sum && list->equal(new MalList(flat)), "list contents")) {
+            return false;
+        }
+        std::cout << "first/rest over " << element_count << " elements:    " << rest_walk << " ms\n";
+        return time_reads<MalList>(list, "list");
+    }
+}
+
+int main() {
+    return vector_bench() && list_bench() ? 0 : 1;
+}
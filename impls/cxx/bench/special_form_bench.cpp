@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include "bench_util.h"
+#include "analyzer.h"
+#include "env.h"
+#include "gc.h"
+#include "evaluator.h"
+#include "reader.h"
+#include "types.h"
+
+namespace {
+    constexpr int dispatch_iterations = 10'000'000;
+    constexpr int call_iterations = 1'000'000;
+
+    // The form tests exec() ran before special forms were tagged: one name()
+    // copy and string compare per form, all of which miss for a plain call.
+    int legacy_dispatch(const MalSymbol* sym) {
+        static const char* const forms[] = {
+            "fn*", "do", "if", "def!", "let*", "quote", "quasiquote", "unquote", "splice-unquote"
+        };
+        int index = 0;
+        for (const auto form: forms) {
+            if (std::string(sym->name()) == form) {
+                return index;
+            }
+            ++index;
+        }
+        return -1;
+    }
+
+    int opcode_dispatch(const MalSymbol* sym) {
+        switch (sym->special()) {
+            case SpecialForm::Fn: return 0;
+            case SpecialForm::Do: return 1;
+            case SpecialForm::If: return 2;
+            case SpecialForm::Def: return 3;
+            case SpecialForm::Let: return 4;
+            case SpecialForm::Quote: return 5;
+            case SpecialForm::QuasiQuote: return 6;
+            case SpecialForm::UnQuote: return 7;
+            case SpecialForm::SpliceUnQuote: return 8;
+            case SpecialForm::None: return -1;
+        }
+        return -1;
+    }
+
+}
+
+int main() {
+    Env global_env;
+    Evaluator::set_env(&global_env);
+
+    const auto callee = new MalSymbol("f");
+    volatile int sink = 0;
+    const double legacy = bench::ns_per_op(dispatch_iterations, [&] { sink = sink + legacy_dispatch(callee); });
+    const double opcode = bench::ns_per_op(dispatch_iterations, [&] { sink = sink + opcode_dispatch(callee); });
+
+    Evaluator::eval(Reader::read_str("(def! f (fn* [x] x))"));
+    MalType* call = Analyzer::analyze(Reader::read_str("(f 1)"));
+    GC::add_root(&call);
+    const double per_call = bench::ns_per_op(call_iterations, [&] { Evaluator::exec(call, &global_env); });
+
+    std::cout << "special form dispatch, string compares: " << legacy << " ns/form\n";
+    std::cout << "special form dispatch, opcode switch:   " << opcode << " ns/form\n";
+    std::cout << "(f 1) through Evaluator::exec:          " << per_call << " ns/call\n";
+    return 0;
+}
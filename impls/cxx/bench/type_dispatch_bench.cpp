@@ -0,0 +1,73 @@
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include "bench_util.h"
+#include "env.h"
+#include "evaluator.h"
+#include "gc.h"
+#include "reader.h"
+#include "types.h"
+
+namespace {
+    constexpr int dispatch_iterations = 2'000'000;
+    constexpr int eval_iterations = 200'000;
+
+    // The order exec() tested node types in before MalType carried a kind tag.
+    int legacy_dispatch(MalType* form) {
+        if (dynamic_cast<MalLocal*>(form)) return 0;
+        if (dynamic_cast<MalSymbol*>(form)) return 1;
+        if (dynamic_cast<MalList*>(form)) return 2;
+        if (dynamic_cast<MalVector*>(form)) return 3;
+        if (dynamic_cast<MalMap*>(form)) return 4;
+        if (dynamic_cast<MalSyntaxQuote*>(form)) return 5;
+        return 6;
+    }
+
+    int kind_dispatch(MalType* form) {
+        switch (form->kind()) {
+            case MalKind::Local: return 0;
+            case MalKind::Symbol: return 1;
+            case MalKind::List: return 2;
+            case MalKind::Vector: return 3;
+            case MalKind::Map: return 4;
+            case MalKind::Quote:
+            case MalKind::QuasiQuote:
+            case MalKind::UnQuote:
+            case MalKind::UnQuoteSplicing:
+            case MalKind::Deref:
+            case MalKind::MetaSymbol: return 5;
+            default: return 6;
+        }
+    }
+
+}
+
+int main() {
+    Env global_env;
+    Evaluator::set_env(&global_env);
+
+    // One node of each shape the evaluator sees, atoms last as they fall through every test.
+    std::vector<MalType*> forms = {
+        new MalLocal(new MalSymbol("x"), 0, 0), new MalSymbol("f"), new MalList{}, new MalVector{},
+        new MalMap, new MalQuote(new MalInt(1)), new MalInt(1), new MalString("s"), MalNil::instance(),
+    };
+    GC::add_root(&forms);
+
+    volatile int sink = 0;
+    const double legacy = bench::ns_per_op(dispatch_iterations, [&] {
+        for (const auto form: forms) sink = sink + legacy_dispatch(form);
+    }) / static_cast<double>(forms.size());
+    const double kind = bench::ns_per_op(dispatch_iterations, [&] {
+        for (const auto form: forms) sink = sink + kind_dispatch(form);
+    }) / static_cast<double>(forms.size());
+
+    Evaluator::eval(Reader::read_str("(def! sum (fn* [n acc] (if (= n 0) acc (sum (- n 1) (+ acc n)))))"));
+    MalType* call = Reader::read_str("(sum 20 0)");
+    GC::add_root(&call);
+    const double per_eval = bench::ns_per_op(eval_iterations, [&] { Evaluator::eval(call, &global_env); });
+
+    std::cout << "node dispatch, dynamic_cast chain: " << legacy << " ns/node\n";
+    std::cout << "node dispatch, kind() switch:      " << kind << " ns/node\n";
+    std::cout << "(sum 20 0) through Evaluator::eval: " << per_eval << " ns/eval\n";
+    return 0;
+}
@@ -1,36 +1,68 @@
-#include <iostream>
 #include "builtin.h"
 #include <sstream>
 #include <fstream>
+#include <algorithm>
 #include "reader.h"
 #include "printer.h"
 #include "error.h"
 #include "evaluator.h"
+#include "gc.h"
+#include "mapped_file.h"
+#include "output.h"
 
 
-MalType* operator_plus(const std::vector<MalType *> &args) {
+namespace {
+    template <typename Compare>
+    MalType* compare_ints(MalType* lhs, MalType* rhs, Compare cmp) {
+        const auto lhs_int = dyn_cast<MalInt>(lhs);
+        const auto rhs_int = dyn_cast<MalInt>(rhs);
+        if (!lhs_int || !rhs_int) {
+            throw argInvalidError("wrong type");
+        }
+        return MalBool::instance(cmp(lhs_int->get_elem(), rhs_int->get_elem()));
+    }
+}
+
+MalType* Builtin::call(const std::span<MalType* const> args) const {
+    if (this->arity != variadic_arity && args.size() != static_cast<std::size_t>(this->arity)) {
+        throw argInvalidError("expected " + std::to_string(this->arity) + (this->arity == 1 ? " arg" : " args") +
+                              ", given " + std::to_string(args.size()) + " arg(s)");
+    }
+    switch (this->arity) {
+        case 0:
+            return this->nullary_();
+        case 1:
+            return this->unary_(args[0]);
+        case 2:
+            return this->binary_(args[0], args[1]);
+        default:
+            return this->variadic_(args);
+    }
+}
+
+MalType* operator_plus(std::span<MalType* const> args) {
     int64_t result = 0;
     for (const auto& arg: args) {
-        const auto num = dynamic_cast<MalInt*>(arg);
+        const auto num = dyn_cast<MalInt>(arg);
         if (!num){
             throw argInvalidError("wrong type");
         }
         result += num->get_elem();
     }
-    return new MalInt(result);
+    return MalInt::of(result);
 }
 
-MalType* operator_minus(const std::vector<MalType *> &args) {
+MalType* operator_minus(std::span<MalType* const> args) {
     if (args.empty()){
         throw argInvalidError("empty arg list");
     }
-    const auto first = dynamic_cast<MalInt*>(args[0]);
+    const auto first = dyn_cast<MalInt>(args[0]);
     if (!first) {
         throw argInvalidError("wrong type");
     }
     int64_t result = first->get_elem();
     for (std::size_t i = 1; i < args.size(); ++i) {
-        const auto arg = dynamic_cast<MalInt*>(args[i]);
+        const auto arg = dyn_cast<MalInt>(args[i]);
         if (!arg) {
             throw argInvalidError("wrong type");
         }
@@ -41,32 +73,32 @@ MalType* operator_minus(const std::vector<MalType *> &args) {
         result -= num;
     }
 
-    return new MalInt(result);
+    return MalInt::of(result);
 }
 
-MalType* operator_multiply(const std::vector<MalType *> &args) {
+MalType* operator_multiply(std::span<MalType* const> args) {
     int64_t result = 1;
     for (const auto& arg: args) {
-        const auto num = dynamic_cast<MalInt*>(arg);
+        const auto num = dyn_cast<MalInt>(arg);
         if (!num){
             throw argInvalidError("wrong type");
         }
         result *= num->get_elem();
     }
-    return new MalInt(result);
+    return MalInt::of(result);
 }
 
-MalType* operator_divide(const std::vector<MalType *> &args) {
+MalType* operator_divide(std::span<MalType* const> args) {
     if (args.empty()){
         throw argInvalidError("empty arg list");
     }
-    const auto first = dynamic_cast<MalInt*>(args[0]);
+    const auto first = dyn_cast<MalInt>(args[0]);
     if (!first) {
         throw argInvalidError("wrong type");
     }
     int64_t result = first->get_elem();
     for (std::size_t i = 1; i < args.size(); ++i) {
-        const auto arg = dynamic_cast<MalInt*>(args[i]);
+        const auto arg = dyn_cast<MalInt>(args[i]);
         if (!arg) {
             throw argInvalidError("wrong type");
         }
@@ -77,317 +109,376 @@ MalType* operator_divide(const std::vector<MalType *> &args) {
         result /= num;
     }
 
-    return new MalInt(result);
+    return MalInt::of(result);
 }
 
-MalType* str(const std::vector<MalType *>& args) {
-    const auto args_str = print_helper(args, false);
-    std::stringstream ss;
-    for (const auto& s: args_str){
-        ss << s;
-    }
-    return new MalString(ss.str());
+MalType* str(std::span<MalType* const> args) {
+    return new MalString(print_helper(args, false, ""));
 }
 
-MalType* pr_str(const std::vector<MalType *>& args) {
-    const auto args_str = print_helper(args, true);
-    std::stringstream ss;
-    bool first = true;
-    ss << "\"";
-    for (const auto& s: args_str){
-        if (!first) {
-            ss << " ";
-        }
-        ss << s;
-        first = false;
-    }
-    ss << "\"";
-    return new MalString(ss.str());
+MalType* pr_str(std::span<MalType* const> args) {
+    return new MalString(print_helper(args, true, " "));
 }
 
-MalType* prn(const std::vector<MalType*>& args) {
-    const auto args_str = print_helper(args, true);
-    std::stringstream ss;
-    bool first = true;
-    for (const auto& s: args_str){
-        if (!first) {
-            ss << " ";
-        }
-        ss << s;
-        first = false;
-    }
-    std::cout << ss.str();
-    return new MalNil;
+MalType* prn(std::span<MalType* const> args) {
+    Output::write(print_helper(args, true, " "));
+    return MalNil::instance();
 }
 
-MalType* println(const std::vector<MalType *>& args) {
-    const auto args_str = print_helper(args, false);
-    std::stringstream ss;
-    bool first = true;
-    for (const auto& s: args_str){
-        if (!first) {
-            ss << " ";
-        }
-        ss << s;
-        first = false;
-    }
-    ss << "\n";
-    std::cout << ss.str();
-    return new MalNil;
+MalType* println(std::span<MalType* const> args) {
+    auto out = print_helper(args, false, " ");
+    out += '\n';
+    Output::write(out);
+    return MalNil::instance();
 }
 
-MalType* list(const std::vector<MalType *>& args) {
-    return new MalList(args);
+MalType* flush() {
+    Output::flush();
+    return MalNil::instance();
 }
 
-MalType* is_list(const std::vector<MalType*>& args) {
-    if (args.size() != 1){
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-
-    return new MalBool(dynamic_cast<MalList*>(args[0]));
+MalType* list(std::span<MalType* const> args) {
+    return new MalList(std::vector(args.begin(), args.end()));
 }
 
-MalType* is_empty(const std::vector<MalType*>& args) {
-    if (args.size() != 1){
-        return new MalBool(false);
-    }
+MalType* is_list(MalType* arg) {
+    return MalBool::instance(isa<MalList>(arg));
+}
 
-    const auto arg = dynamic_cast<MalSequence*>(args[0]);
-    return new MalBool(arg && arg->get_elem().empty());
+MalType* is_empty(MalType* arg) {
+    const auto sequence = dyn_cast<MalSequence>(arg);
+    return MalBool::instance(sequence && sequence->empty());
 }
 
-MalType* count(const std::vector<MalType *>& args) {
-    if (args.size() != 1){
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    if (dynamic_cast<MalNil*>(args[0])){
-        return new MalInt(0);
+MalType* count(MalType* arg) {
+    if (isa<MalNil>(arg)){
+        return MalInt::of(0);
     }
-    auto sequence = dynamic_cast<MalSequence*>(args[0]);
+    auto sequence = dyn_cast<MalSequence>(arg);
     if (!sequence){
         throw argInvalidError("wrong type");
     }
-    return new MalInt(static_cast<int64_t>(sequence->get_elem().size()));
+    return MalInt::of(static_cast<int64_t>(sequence->size()));
 }
 
-MalType* equal(const std::vector<MalType *> &args) {
-    if (args.size() != 2){
-        throw argInvalidError("expected 2 args, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    return new MalBool(args[0]->equal(args[1]));
+MalType* equal(MalType* lhs, MalType* rhs) {
+    return MalBool::instance(lhs->equal(rhs));
 }
 
-MalType* less(const std::vector<MalType*>& args) {
-    return compare_ints(args, std::less<int64_t>{});
+MalType* less(MalType* lhs, MalType* rhs) {
+    return compare_ints(lhs, rhs, std::less<int64_t>{});
 }
 
-MalType* less_equal(const std::vector<MalType*>& args) {
-    return compare_ints(args, std::less_equal<int64_t>{});
+MalType* less_equal(MalType* lhs, MalType* rhs) {
+    return compare_ints(lhs, rhs, std::less_equal<int64_t>{});
 }
 
-MalType* greater(const std::vector<MalType*>& args) {
-    return compare_ints(args, std::greater<int64_t>{});
+MalType* greater(MalType* lhs, MalType* rhs) {
+    return compare_ints(lhs, rhs, std::greater<int64_t>{});
 }
 
-MalType* greater_equal(const std::vector<MalType*>& args) {
-    return compare_ints(args, std::greater_equal<int64_t>{});
+MalType* greater_equal(MalType* lhs, MalType* rhs) {
+    return compare_ints(lhs, rhs, std::greater_equal<int64_t>{});
 }
 
-MalType* not_func(const std::vector<MalType*>& args) {
-    if (args.size() != 1) {
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-
-    MalType* arg = args[0];
-    const bool truthy = (!dynamic_cast<MalBool*>(arg) || dynamic_cast<MalBool*>(arg)->get_elem())
-                  && !dynamic_cast<MalNil*>(arg);
-    return new MalBool(!truthy);
+MalType* not_func(MalType* arg) {
+    return MalBool::instance(!Evaluator::truthy(arg));
 }
 
-MalType* compare_ints(const std::vector<MalType *> &args, const std::function<bool(int64_t, int64_t)>& cmp) {
-    if (args.size() != 2) {
-        throw argInvalidError("expected 2 args, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    const auto lhs = dynamic_cast<MalInt*>(args[0]);
-    const auto rhs = dynamic_cast<MalInt*>(args[1]);
-    if (!lhs || !rhs) {
-        throw argInvalidError("wrong type");
-    }
-    return new MalBool(cmp(lhs->get_elem(), rhs->get_elem()));
-}
-
-std::vector<std::string> print_helper(const std::vector<MalType*>& args, const bool print_readably)
+std::string print_helper(std::span<MalType* const> args, const bool print_readably,
+                         const std::string_view separator)
 {
-    std::vector<std::string> res;
+    std::string out;
     for (const auto& arg: args)
     {
-        res.emplace_back(Printer::pr_str(arg, print_readably));
+        if (&arg != &args.front()) {
+            out += separator;
+        }
+        Printer::print(out, arg, print_readably);
     }
-    return res;
+    return out;
 }
 
-MalType* read_string(const std::vector<MalType*>& args) {
-    if (args.size() != 1) {
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    auto str = dynamic_cast<const MalString*>(args[0]);
+MalType* read_string(MalType* arg) {
+    auto str = dyn_cast<MalString>(arg);
     if (!str){
         throw argInvalidError("wrong type");
     }
-    return Reader::read_str(Reader::remove_comments(str->to_string(false)));
+    return Reader::read_str(str->view());
 }
 
-MalType* slurp(const std::vector<MalType*>& args) {
-    if (args.size() != 1) {
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    auto str = dynamic_cast<const MalString*>(args[0]);
+MalType* slurp(MalType* arg) {
+    auto str = dyn_cast<MalString>(arg);
     if (!str){
         throw argInvalidError("wrong type");
     }
-    std::ifstream ifs(str->to_string(false));
+    const std::string path(str->view());
+    if (const auto file = MappedFile::open(path)) {
+        return new MalString(file, file->contents());
+    }
+    std::ifstream ifs(path);
     if (!ifs){
-        throw IOError("Can not open file: " + str->to_string(false));
+        throw IOError("Can not open file: " + path);
     }
     std::stringstream ss;
     ss << ifs.rdbuf();
     return new MalString(ss.str());
 }
 
-MalType* evals(const std::vector<MalType *>& args) {
-    if (args.size() != 1) {
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    return Evaluator::eval(args[0]);
+MalType* evals(MalType* arg) {
+    return Evaluator::eval(arg);
 }
 
-MalType* load_file_repl(const std::vector<MalType*>& args){
-    return load_file(args, true);
+namespace {
+    // Each top-level form runs as soon as it is read, so only one form's tokens are held at a time.
+    MalType* eval_each(Reader& reader) {
+        while (MalType* form = Reader::read_next(reader)) {
+            Evaluator::eval(form);
+        }
+        return MalNil::instance();
+    }
 }
 
-MalType* load_file(const std::vector<MalType*>& args, bool repl_mode) {
-    auto file = slurp(args);
-    auto str = dynamic_cast<MalString*>(file);
-    if (!str) throw argInvalidError("slurp did not return string");
-
-    const std::string no_comment = Reader::remove_comments(str->get_elem());
-
-    const std::string wrapped = repl_mode ? "(do " + no_comment + "\n nil)" : no_comment;
-
-    std::vector<MalType*> wrapped_args{ new MalString(wrapped) };
-    auto ast = read_string(wrapped_args);
-    return evals({ast});
+MalType* load_file(MalType* arg) {
+    auto str = dyn_cast<MalString>(arg);
+    if (!str){
+        throw argInvalidError("wrong type");
+    }
+    // A regular file is tokenized in place over its mapping, kept alive by a rooted slice of it;
+    // pipes and other files that cannot be mapped are streamed.
+    const std::string path(str->view());
+    GCRootScope roots;
+    MalType* source = nullptr;
+    GC::add_root(&source);
+    if (const auto file = MappedFile::open(path)) {
+        source = new MalString(file, file->contents());
+        Reader reader(cast<MalString>(source)->view());
+        return eval_each(reader);
+    }
+    std::ifstream ifs(path);
+    if (!ifs){
+        throw IOError("Can not open file: " + path);
+    }
+    Reader reader(ifs);
+    return eval_each(reader);
 }
 
-MalType* atom(const std::vector<MalType*>& args) {
-    if (args.size() != 1) {
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    return new MalRef(args[0]);
+MalType* atom(MalType* arg) {
+    return new MalRef(arg);
 }
 
-MalType* is_atom(const std::vector<MalType*>& args) {
-    if (args.size() != 1) {
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    return new MalBool(dynamic_cast<const MalRef*>(args[0]));
+MalType* is_atom(MalType* arg) {
+    return MalBool::instance(isa<MalRef>(arg));
 }
 
-MalType* deref(const std::vector<MalType*>& args) {
-    if (args.size() != 1) {
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    const auto ref = dynamic_cast<const MalRef*>(args[0]);
+MalType* deref(MalType* arg) {
+    const auto ref = dyn_cast<MalRef>(arg);
     if (!ref){
         throw argInvalidError("wrong type");
     }
     return ref->get();
 }
 
-MalType* reset(const std::vector<MalType*>& args) {
-    if (args.size() != 2) {
-        throw argInvalidError("expected 2 args, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    auto ref = dynamic_cast<MalRef*>(args[0]);
+MalType* reset(MalType* ref_arg, MalType* value) {
+    auto ref = dyn_cast<MalRef>(ref_arg);
     if (!ref){
         throw argInvalidError("wrong type");
     }
-    ref->set(args[1]);
-    return args[1];
+    ref->set(value);
+    return value;
 }
 
-MalType* swap(const std::vector<MalType*>& args) {
+MalType* swap(std::span<MalType* const> args) {
     if (args.size() < 2) {
         throw argInvalidError("expected at least 2 args, given " +
                               std::to_string(args.size()) + " arg(s)");
     }
 
-    auto ref = dynamic_cast<MalRef*>(args[0]);
-    auto fn = dynamic_cast<MalFunction*>(args[1]);
+    auto ref = dyn_cast<MalRef>(args[0]);
+    auto fn = dyn_cast<MalFunction>(args[1]);
     if (!ref || !fn) {
         throw argInvalidError("wrong type");
     }
 
-    std::vector<MalType*> fn_args;
-    fn_args.push_back(ref->get());
-    for (size_t i = 2; i < args.size(); ++i) {
-        fn_args.push_back(args[i]);
-    }
+    const ArgFrame frame(args.size() - 1);
+    const auto fn_args = frame.slots();
+    fn_args[0] = ref->get();
+    std::copy(args.begin() + 2, args.end(), fn_args.begin() + 1);
 
     MalType* result = fn->apply(fn_args);
     ref->set(result);
     return result;
 }
 
-MalType* cons(const std::vector<MalType*>& args) {
-    if (args.size() != 2) {
-        throw argInvalidError("expected 2 args, given " +
-                              std::to_string(args.size()) + " arg(s)");
-    }
-    const auto sequence = dynamic_cast<MalSequence*>(args[1]);
+MalType* cons(MalType* head, MalType* tail_arg) {
+    const auto sequence = dyn_cast<MalSequence>(tail_arg);
     if (!sequence){
         throw argInvalidError("wrong type");
     }
-    std::vector<MalType*> elems = sequence->get_elem();
-    elems.emplace(elems.begin(), args[0]);
+    if (const auto list = dyn_cast<MalList>(sequence)) {
+        return MalList::cons(head, list);
+    }
+    std::vector<MalType*> elems;
+    elems.reserve(sequence->size() + 1);
+    elems.push_back(head);
+    elems.insert(elems.end(), sequence->begin(), sequence->end());
     return new MalList(elems);
 }
 
-MalType* concat(const std::vector<MalType*>& args) {
+MalType* concat(std::span<MalType* const> args) {
     std::vector<MalType*> elems;
     for (const auto& arg : args) {
-        auto seq = dynamic_cast<MalSequence*>(arg);
-        if (!seq) {
+        if (!isa<MalSequence>(arg)) {
             throw argInvalidError("concat expects sequence types");
         }
-        const auto& part = seq->get_elem();
-        elems.insert(elems.end(), part.begin(), part.end());
     }
-    return new MalList(elems);
+    // A trailing list becomes the shared tail of the result; everything before it is copied.
+    const auto tail = args.empty() ? nullptr : dyn_cast<MalList>(args.back());
+    const auto copied = tail ? args.size() - 1 : args.size();
+    for (std::size_t i = 0; i < copied; ++i) {
+        const auto seq = cast<MalSequence>(args[i]);
+        elems.insert(elems.end(), seq->begin(), seq->end());
+    }
+    return new MalList(std::move(elems), tail);
 }
 
-MalType* vec(const std::vector<MalType*>& args) {
-    if (args.size() != 1) {
-        throw argInvalidError("expected 1 arg, given " +
-                              std::to_string(args.size()) + " arg(s)");
+MalType* first(MalType* arg) {
+    if (isa<MalNil>(arg)) {
+        return MalNil::instance();
+    }
+    const auto sequence = dyn_cast<MalSequence>(arg);
+    if (!sequence) {
+        throw argInvalidError("wrong type");
+    }
+    return sequence->empty() ? MalNil::instance() : sequence->nth(0);
+}
+
+MalType* rest(MalType* arg) {
+    if (isa<MalNil>(arg)) {
+        return MalList::empty_instance();
+    }
+    if (const auto list = dyn_cast<MalList>(arg)) {
+        return list->rest();
+    }
+    const auto sequence = dyn_cast<MalSequence>(arg);
+    if (!sequence) {
+        throw argInvalidError("wrong type");
     }
-    auto sequence = dynamic_cast<MalSequence*>(args[0]);
+    auto elems = sequence->to_vector();
+    if (!elems.empty()) {
+        elems.erase(elems.begin());
+    }
+    return new MalList(elems);
+}
+
+MalType* vec(MalType* arg) {
+    auto sequence = dyn_cast<MalSequence>(arg);
     if (!sequence){
         throw argInvalidError("wrong type");
     }
-    return dynamic_cast<MalVector*>(sequence) ? args[0]
-        : new MalVector({sequence->get_elem().begin(), sequence->get_elem().end()});
+    return isa<MalVector>(sequence) ? arg : new MalVector(cast<MalList>(sequence)->get_elem());
+}
+
+MalType* conj(std::span<MalType* const> args) {
+    if (args.empty()) {
+        throw argInvalidError("expected at least 1 arg, given 0 arg(s)");
+    }
+    if (const auto vector = dyn_cast<MalVector>(args[0])) {
+        PVector elements = vector->get_elem();
+        for (std::size_t i = 1; i < args.size(); ++i) {
+            elements = elements.conj(args[i]);
+        }
+        return new MalVector(elements);
+    }
+    const auto list = dyn_cast<MalList>(args[0]);
+    if (!list) {
+        throw argInvalidError("wrong type");
+    }
+    // Each item goes on the front in turn, so the original list is shared as the tail of the result.
+    MalList* result = list;
+    for (std::size_t i = 1; i < args.size(); ++i) {
+        result = MalList::cons(args[i], result);
+    }
+    return result;
+}
+
+MalType* nth(MalType* sequence_arg, MalType* index_arg) {
+    const auto sequence = dyn_cast<MalSequence>(sequence_arg);
+    const auto index = dyn_cast<MalInt>(index_arg);
+    if (!sequence || !index) {
+        throw argInvalidError("wrong type");
+    }
+    if (index->get_elem() < 0 || static_cast<std::size_t>(index->get_elem()) >= sequence->size()) {
+        throw valueError("index out of range");
+    }
+    return sequence->nth(static_cast<std::size_t>(index->get_elem()));
+}
+
+MalType* gc_stats() {
+    const auto& stats = GC::stats();
+    const auto map = new MalMap;
+    map->put(MalKeyword::intern("heap-objects"), MalInt::of(static_cast<int64_t>(stats.heap_objects)));
+    map->put(MalKeyword::intern("heap-bytes"), MalInt::of(static_cast<int64_t>(stats.heap_bytes)));
+    map->put(MalKeyword::intern("collections"), MalInt::of(static_cast<int64_t>(stats.collections)));
+    map->put(MalKeyword::intern("freed-objects"), MalInt::of(static_cast<int64_t>(stats.freed_objects)));
+    map->put(MalKeyword::intern("last-pause-us"), MalInt::of(stats.last_pause_us));
+    map->put(MalKeyword::intern("max-pause-us"), MalInt::of(stats.max_pause_us));
+    map->put(MalKeyword::intern("total-pause-us"), MalInt::of(stats.total_pause_us));
+    return map;
+}
+
+MalType* alloc_stats() {
+    const auto& stats = GC::stats();
+    const auto map = new MalMap;
+    map->put(MalKeyword::intern("pool-hits"), MalInt::of(static_cast<int64_t>(stats.pool_hits)));
+    map->put(MalKeyword::intern("pool-misses"), MalInt::of(static_cast<int64_t>(stats.pool_misses)));
+    map->put(MalKeyword::intern("unpooled-allocs"), MalInt::of(static_cast<int64_t>(stats.unpooled_allocs)));
+    map->put(MalKeyword::intern("pool-slab-bytes"), MalInt::of(static_cast<int64_t>(stats.pool_slab_bytes)));
+    return map;
+}
+
+namespace {
+    constexpr Builtin builtin_table[] = {
+        {"+", operator_plus, Primitive::Add},
+        {"-", operator_minus, Primitive::Sub},
+        {"*", operator_multiply, Primitive::Mul},
+        {"/", operator_divide},
+        {"str", str},
+        {"pr-str", pr_str},
+        {"prn", prn},
+        {"println", println},
+        {"flush", flush},
+        {"list", list},
+        {"list?", is_list},
+        {"empty?", is_empty},
+        {"count", count},
+        {"=", equal, Primitive::Eq},
+        {"<", less, Primitive::Lt},
+        {"<=", less_equal, Primitive::Le},
+        {">", greater, Primitive::Gt},
+        {">=", greater_equal, Primitive::Ge},
+        {"not", not_func},
+        {"read-string", read_string},
+        {"slurp", slurp},
+        {"eval", evals},
+        {"load-file", load_file},
+        {"atom", atom},
+        {"atom?", is_atom},
+        {"deref", deref},
+        {"reset!", reset},
+        {"swap!", swap},
+        {"cons", cons},
+        {"concat", concat},
+        {"first", first},
+        {"rest", rest},
+        {"vec", vec},
+        {"conj", conj},
+        {"nth", nth},
+        {"gc-stats", gc_stats},
+        {"alloc-stats", alloc_stats},
+    };
+}
+
+std::span<const Builtin> builtins() {
+    return builtin_table;
 }
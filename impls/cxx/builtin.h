@@ -3,42 +3,81 @@
 
 #include "types.h"
 
-MalType* compare_ints(const std::vector<MalType*>& args,
-                      const std::function<bool(int64_t, int64_t)>& cmp);
-std::vector<std::string> print_helper(const std::vector<MalType*>& args, bool print_readably);
-
-
-MalType* operator_plus(const std::vector<MalType*>& args);
-MalType* operator_minus(const std::vector<MalType*>& args);
-MalType* operator_multiply(const std::vector<MalType*>& args);
-MalType* operator_divide(const std::vector<MalType*>& args);
-MalType* str(const std::vector<MalType*>& args);
-MalType* pr_str(const std::vector<MalType*>& args);
-MalType* prn(const std::vector<MalType*>& args);
-MalType* println(const std::vector<MalType*>& args);
-MalType* list(const std::vector<MalType*>& args);
-MalType* is_list(const std::vector<MalType*>& args);
-MalType* is_empty(const std::vector<MalType*>& args);
-MalType* count(const std::vector<MalType*>& args);
-MalType* equal(const std::vector<MalType*>& args);
-MalType* less(const std::vector<MalType*>& args);
-MalType* less_equal(const std::vector<MalType*>& args);
-MalType* greater(const std::vector<MalType*>& args);
-MalType* greater_equal(const std::vector<MalType*>& args);
-MalType* not_func(const std::vector<MalType*>& args);
-MalType* read_string(const std::vector<MalType*>& args);
-MalType* slurp(const std::vector<MalType*>& args);
-MalType* evals(const std::vector<MalType*>& args);
-MalType* load_file(const std::vector<MalType *> &args, bool repl_mode);
-MalType* load_file_repl(const std::vector<MalType *> &args);
-MalType* atom(const std::vector<MalType*>& args);
-MalType* is_atom(const std::vector<MalType*>& args);
-MalType* deref(const std::vector<MalType*>& args);
-MalType* reset(const std::vector<MalType*>& args);
-MalType* swap(const std::vector<MalType*>& args);
-MalType* cons(const std::vector<MalType*>& args);
-MalType* concat(const std::vector<MalType*>& args);
-MalType* vec(const std::vector<MalType*>& args);
+// A native function in the builtin table. Fixed-arity builtins take their arguments directly, with the
+// count checked once by call(); variadic ones get the whole argument span.
+struct Builtin {
+    using Nullary = MalType* (*)();
+    using Unary = MalType* (*)(MalType*);
+    using Binary = MalType* (*)(MalType*, MalType*);
+    using Variadic = MalType* (*)(std::span<MalType* const>);
+    static constexpr int variadic_arity = -1;
+
+    const char* name;
+    int arity;
+    Primitive primitive = Primitive::None;
+
+    constexpr Builtin(const char* name, const Nullary fn) : name(name), arity(0), nullary_(fn) {}
+    constexpr Builtin(const char* name, const Unary fn) : name(name), arity(1), unary_(fn) {}
+    constexpr Builtin(const char* name, const Binary fn, const Primitive primitive = Primitive::None)
+        : name(name), arity(2), primitive(primitive), binary_(fn) {}
+    constexpr Builtin(const char* name, const Variadic fn, const Primitive primitive = Primitive::None)
+        : name(name), arity(variadic_arity), primitive(primitive), variadic_(fn) {}
+
+    MalType* call(std::span<MalType* const> args) const;
+
+private:
+    union {
+        Nullary nullary_;
+        Unary unary_;
+        Binary binary_;
+        Variadic variadic_;
+    };
+};
+
+// Every builtin the global environment starts with.
+std::span<const Builtin> builtins();
+
+// Prints every argument into one string, separator between them.
+std::string print_helper(std::span<MalType* const> args, bool print_readably, std::string_view separator);
+
+
+MalType* operator_plus(std::span<MalType* const> args);
+MalType* operator_minus(std::span<MalType* const> args);
+MalType* operator_multiply(std::span<MalType* const> args);
+MalType* operator_divide(std::span<MalType* const> args);
+MalType* str(std::span<MalType* const> args);
+MalType* pr_str(std::span<MalType* const> args);
+MalType* prn(std::span<MalType* const> args);
+MalType* println(std::span<MalType* const> args);
+MalType* flush();
+MalType* list(std::span<MalType* const> args);
+MalType* is_list(MalType* arg);
+MalType* is_empty(MalType* arg);
+MalType* count(MalType* arg);
+MalType* equal(MalType* lhs, MalType* rhs);
+MalType* less(MalType* lhs, MalType* rhs);
+MalType* less_equal(MalType* lhs, MalType* rhs);
+MalType* greater(MalType* lhs, MalType* rhs);
+MalType* greater_equal(MalType* lhs, MalType* rhs);
+MalType* not_func(MalType* arg);
+MalType* read_string(MalType* arg);
+MalType* slurp(MalType* arg);
+MalType* evals(MalType* arg);
+MalType* load_file(MalType* arg);
+MalType* atom(MalType* arg);
+MalType* is_atom(MalType* arg);
+MalType* deref(MalType* arg);
+MalType* reset(MalType* ref_arg, MalType* value);
+MalType* swap(std::span<MalType* const> args);
+MalType* cons(MalType* head, MalType* tail_arg);
+MalType* concat(std::span<MalType* const> args);
+MalType* first(MalType* arg);
+MalType* rest(MalType* arg);
+MalType* vec(MalType* arg);
+MalType* conj(std::span<MalType* const> args);
+MalType* nth(MalType* sequence_arg, MalType* index_arg);
+MalType* gc_stats();
+MalType* alloc_stats();
 
 
 #endif //BUILTIN_H
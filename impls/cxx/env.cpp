@@ -5,36 +5,9 @@
 
 void Env::builtin_register() {
     this->add("*ARGV*", new MalList({}));
-    this->add("+", new MalFunction(operator_plus));
-    this->add("-", new MalFunction(operator_minus));
-    this->add("*", new MalFunction(operator_multiply));
-    this->add("/", new MalFunction(operator_divide));
-    this->add("str", new MalFunction(str));
-    this->add("pr-str", new MalFunction(pr_str));
-    this->add("prn", new MalFunction(prn));
-    this->add("println", new MalFunction(println));
-    this->add("list", new MalFunction(list));
-    this->add("list?", new MalFunction(is_list));
-    this->add("empty?", new MalFunction(is_empty));
-    this->add("count", new MalFunction(count));
-    this->add("=", new MalFunction(equal));
-    this->add("<", new MalFunction(less));
-    this->add("<=", new MalFunction(less_equal));
-    this->add(">", new MalFunction(greater));
-    this->add(">=", new MalFunction(greater_equal));
-    this->add("not", new MalFunction(not_func));
-    this->add("read-string", new MalFunction(read_string));
-    this->add("slurp", new MalFunction(slurp));
-    this->add("eval", new MalFunction(evals));
-    this->add("load-file", new MalFunction(load_file_repl));
-    this->add("atom", new MalFunction(atom));
-    this->add("atom?", new MalFunction(is_atom));
-    this->add("deref", new MalFunction(deref));
-    this->add("reset!", new MalFunction(reset));
-    this->add("swap!", new MalFunction(swap));
-    this->add("cons", new MalFunction(cons));
-    this->add("concat", new MalFunction(concat));
-    this->add("vec", new MalFunction(vec));
+    for (const auto& builtin: builtins()) {
+        this->add(builtin.name, new MalFunction(&builtin));
+    }
 }
 
 Env::Env(Env *host, const bool is_global)
@@ -44,67 +17,165 @@ Env::Env(Env *host, const bool is_global)
     }
 }
 
+MalType** Env::lookup(const Symbol* name) {
+    if (this->symbols_.empty()) {
+        return nullptr;
+    }
+    const auto it = this->symbols_.find(name);
+    return it != this->symbols_.end() ? &it->second : nullptr;
+}
+
 void Env::add(const std::string& name, MalType *symbol) {
-    this->symbols.insert({name, symbol});
+    this->add(SymbolTable::intern(name), symbol);
+}
+
+void Env::add(const Symbol* name, MalType *symbol) {
+    this->symbols_.emplace(name, symbol);
 }
 
 MalType *Env::get(const std::string &name) {
-    if (this->symbols.contains(name))
-        return this->symbols[name];
-    if (this->host_env != nullptr)
-        return this->host_env->get(name);
+    return this->get(SymbolTable::intern(name));
+}
+
+MalType *Env::get(const Symbol* name) {
+    for (Env* env = this; env; env = env->host_env) {
+        if (const auto value = env->lookup(name)) {
+            return *value;
+        }
+    }
     return nullptr;
 }
 
 void Env::set(const std::string &name, MalType *symbol) {
-    this->symbols[name] = symbol;
+    this->set(SymbolTable::intern(name), symbol);
+}
+
+void Env::set(const Symbol* name, MalType *symbol) {
+    this->symbols_[name] = symbol;
+}
+
+MalType* Env::get_slot(std::size_t depth, const std::size_t slot) {
+    Env* env = this;
+    for (; depth > 0; --depth) {
+        env = env->host_env;
+    }
+    if (slot >= env->slots_.size()) {
+        return nullptr;
+    }
+    // Box an inline value once and keep the object, so repeated reads hand out the same MalType.
+    Value& value = env->slots_[slot];
+    if (!value.is_object() && !value.is_null()) {
+        value = Value::object(value.box());
+    }
+    return value.as_object();
+}
+
+Value Env::get_value(std::size_t depth, const std::size_t slot) const {
+    const Env* env = this;
+    for (; depth > 0; --depth) {
+        env = env->host_env;
+    }
+    return slot < env->slots_.size() ? env->slots_[slot] : Value();
+}
+
+void Env::set_slot(const std::size_t slot, MalType* value) {
+    this->set_value(slot, Value::object(value));
+}
+
+void Env::set_value(const std::size_t slot, const Value value) {
+    if (slot >= this->slots_.size()) {
+        this->slots_.resize(slot + 1);
+    }
+    this->slots_[slot] = value;
+}
+
+bool Env::is_global() const {
+    return this->global_;
+}
+
+void Env::trace() const {
+    for (const auto value: this->slots_) {
+        if (value.is_object()) {
+            GC::mark(value.as_object());
+        }
+    }
+    for (const auto& [name, symbol]: this->symbols_) {
+        GC::mark(symbol);
+    }
+    GC::mark(this->host_env);
+}
+
+// The map's nodes are estimated as one link plus the entry; an empty map allocates no buckets of its own.
+std::size_t Env::owned_bytes() const {
+    const auto buckets = this->symbols_.bucket_count() > 1 ? this->symbols_.bucket_count() * sizeof(void*) : 0;
+    return this->slots_.capacity() * sizeof(Value) + buckets +
+           this->symbols_.size() * (sizeof(void*) + sizeof(decltype(this->symbols_)::value_type));
 }
 
 Env* Env::find(const std::string &name) {
-    if (this->symbols.contains(name))
-        return this;
-    if (this->host_env){
-        return this->host_env->find(name);
+    return this->find(SymbolTable::intern(name));
+}
+
+Env* Env::find(const Symbol* name) {
+    for (Env* env = this; env; env = env->host_env) {
+        if (env->lookup(name)) {
+            return env;
+        }
     }
     return nullptr;
 }
 
 Env* Env::clone() const {
-    const auto cloned_env = new Env(this->host_env, this->global_);
-    for (const auto& [name, symbol]: this->symbols){
+    const auto cloned_env = new Env(this->host_env, false);
+    cloned_env->global_ = this->global_;
+    for (const auto value: this->slots_){
+        cloned_env->slots_.push_back(value.is_object() ? Value::object(value.as_object()->clone()) : value);
+    }
+    for (const auto& [name, symbol]: this->symbols_){
         cloned_env->add(name, symbol->clone());
     }
     return cloned_env;
 }
 
-Env::Env(Env *host, const std::vector<std::string> &args_list,
-         MalFunction::mal_func_args_list_type &params_list) : Env(host, false) {
-    if (const auto it = std::ranges::find(args_list, "&"); it != args_list.end()) {
-        if (std::distance(it, args_list.end()) != 2) {
-            throw syntaxError("malfunctioning & param usage");
-        }
+namespace {
+    Value to_value(MalType* param) {
+        return Value::object(param);
+    }
 
-        const std::size_t fixed_arity = std::distance(args_list.begin(), it);
-        if (params_list.size() < fixed_arity) {
-            throw argInvalidError("too few arguments");
-        }
+    Value to_value(const Value param) {
+        return param;
+    }
 
-        for (std::size_t i = 0; i < fixed_arity; ++i) {
-            this->set(args_list[i], params_list[i]);
-        }
+    MalType* to_object(MalType* param) {
+        return param;
+    }
 
-        const auto rest_begin = std::next(params_list.begin(), static_cast<std::vector<MalType*>::difference_type>(fixed_arity));
-        const std::vector<MalType*> rest{rest_begin, params_list.end()};
-        this->set(*(it + 1), new MalList(rest));
-    } else {
-        if (args_list.size() != params_list.size()) {
-            throw argInvalidError("expected " + std::to_string(args_list.size()) +
-                                  " arg(s), given " + std::to_string(params_list.size()) + " arg(s)");
-        }
+    MalType* to_object(const Value param) {
+        return param.box();
+    }
+}
+
+Env::Env(Env *host, const ParamBinding& binding, const std::span<MalType* const> params_list) : Env(host, false) {
+    this->bind_params(binding, params_list);
+}
 
-        auto it_args = args_list.begin();
-        for (auto it_params = params_list.begin(); it_args != args_list.end(); ++it_args, ++it_params) {
-            this->add(*it_args, *it_params);
+Env::Env(Env *host, const ParamBinding& binding, const std::span<const Value> params_list) : Env(host, false) {
+    this->bind_params(binding, params_list);
+}
+
+template <typename Param>
+void Env::bind_params(const ParamBinding& binding, const std::span<const Param> params_list) {
+    const std::size_t fixed_arity = binding.fixed_arity;
+    this->slots_.reserve(fixed_arity + binding.variadic);
+    for (std::size_t i = 0; i < fixed_arity; ++i) {
+        this->slots_.push_back(to_value(params_list[i]));
+    }
+    if (binding.variadic) {
+        std::vector<MalType*> rest;
+        rest.reserve(params_list.size() - fixed_arity);
+        for (std::size_t i = fixed_arity; i < params_list.size(); ++i) {
+            rest.push_back(to_object(params_list[i]));
         }
+        this->slots_.push_back(Value::object(new MalList(std::move(rest))));
     }
 }
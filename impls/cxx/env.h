@@ -1,24 +1,44 @@
 #ifndef ENV_H
 #define ENV_H
 
-#include "map"
+#include <span>
+#include <unordered_map>
 #include "string"
 #include "types.h"
+#include "gc.h"
+#include "value.h"
 
 
-class Env {
-    std::map<std::string, MalType*> symbols;
+class Env : public GCObject {
+    std::vector<Value> slots_;
+    std::unordered_map<const Symbol*, MalType*> symbols_;
     bool global_;
     Env* host_env;
 
     void builtin_register();
+    MalType** lookup(const Symbol* name);
+    template <typename Param>
+    void bind_params(const ParamBinding& binding, std::span<const Param> params_list);
 public:
     explicit Env(Env *host = nullptr, bool is_global = true);
-    Env(Env* host, const std::vector<std::string> &args_list, MalFunction::mal_func_args_list_type& params_list);
+    // The caller checks the argument count against the binding first; see ParamBinding::check_arity.
+    Env(Env* host, const ParamBinding& binding, std::span<MalType* const> params_list);
+    Env(Env* host, const ParamBinding& binding, std::span<const Value> params_list);
     void add(const std::string& name, MalType* symbol);
+    void add(const Symbol* name, MalType* symbol);
     MalType* get(const std::string& name);
+    MalType* get(const Symbol* name);
     Env* find(const std::string& name);
+    Env* find(const Symbol* name);
     void set(const std::string& name, MalType* symbol);
+    void set(const Symbol* name, MalType* symbol);
+    [[nodiscard]] MalType* get_slot(std::size_t depth, std::size_t slot);
+    [[nodiscard]] Value get_value(std::size_t depth, std::size_t slot) const;
+    void set_slot(std::size_t slot, MalType* value);
+    void set_value(std::size_t slot, Value value);
+    [[nodiscard]] bool is_global() const;
+    void trace() const override;
+    [[nodiscard]] std::size_t owned_bytes() const override;
     [[nodiscard]] Env* clone() const;
 };
 
@@ -1,226 +1,351 @@
-#include <iostream>
 #include "evaluator.h"
+#include <algorithm>
+#include <memory>
 #include "env.h"
 #include "error.h"
+#include "gc.h"
+#include "analyzer.h"
+#include "vm.h"
+#include "output.h"
+
+namespace {
+    // Frames are opened and closed in LIFO order. One that does not fit in the current segment starts the
+    // next, so a segment never reallocates while any of its slots are in use.
+    class ArgStack final : public GCRootSet {
+    public:
+        constexpr static std::size_t segment_slots = 4096;
+
+        struct Segment {
+            std::unique_ptr<MalType*[]> slots;
+            std::size_t capacity = 0;
+            std::size_t top = 0;
+        };
+        std::vector<Segment> segments;
+        std::size_t current = 0;
+
+        ArgStack() {
+            GC::add_root(this);
+        }
 
-Env* Evaluator::repl_env = nullptr;
-
-MalType* Evaluator::eval(MalType *input, Env* env) {
-    while (true){
-        if (MalType* dbg = env->get("DEBUG-EVAL")) {
-            auto* b = dynamic_cast<MalBool*>(dbg);
-            if (const auto* n = dynamic_cast<MalNil*>(dbg); !(b && !b->get_elem()) && !n) {
-                std::cout << "EVAL: " << input->to_string(true) << std::endl;
+        void trace() const override {
+            for (const auto& segment: this->segments) {
+                for (std::size_t i = 0; i < segment.top; ++i) {
+                    GC::mark(segment.slots[i]);
+                }
             }
         }
+    } arg_stack;
+}
 
-        if (const auto sym = dynamic_cast<MalSymbol*>(input); sym){
-            MalType* opt = env->get(sym->name());
-            if (!opt){
-                throw typeError("'" + sym->name() + "'" + " not found.");
-            }
-            return opt;
+ArgFrame::ArgFrame(const std::size_t size) : size_(size) {
+    auto& segments = arg_stack.segments;
+    if (segments.empty() || segments[arg_stack.current].capacity - segments[arg_stack.current].top < size) {
+        // Segments past the current one are empty, so the next can be grown without moving live slots.
+        if (!segments.empty()) {
+            ++arg_stack.current;
+        }
+        if (arg_stack.current == segments.size()) {
+            segments.emplace_back();
         }
+        if (auto& next = segments[arg_stack.current]; next.capacity < size) {
+            next.capacity = std::max(size, ArgStack::segment_slots);
+            next.slots = std::make_unique<MalType*[]>(next.capacity);
+        }
+    }
+    auto& segment = segments[arg_stack.current];
+    this->segment_ = arg_stack.current;
+    this->base_ = segment.top;
+    std::fill_n(segment.slots.get() + this->base_, size, nullptr);
+    segment.top += size;
+}
 
-        if (const auto lst = dynamic_cast<MalList*>(input); lst){
-            const auto& lst_elem = lst->get_elem();
-            if (lst_elem.empty()){
-                return lst;
-            }
+ArgFrame::~ArgFrame() {
+    arg_stack.segments[this->segment_].top = this->base_;
+    // A frame at the bottom of a later segment was the one that moved the stack onto it.
+    arg_stack.current = this->base_ == 0 && this->segment_ > 0 ? this->segment_ - 1 : this->segment_;
+}
 
-            const auto first = lst_elem[0];
-            const auto first_sym = dynamic_cast<MalSymbol*>(first);
-            if (first_sym && first_sym->name() == "fn*"){
-                if (lst_elem.size() != 3){
-                    throw syntaxError("expected 2 args, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
-                }
+std::span<MalType*> ArgFrame::slots() const {
+    return {arg_stack.segments[this->segment_].slots.get() + this->base_, this->size_};
+}
 
-                const auto args_list = dynamic_cast<MalSequence*>(lst_elem[1]);
-                if (!args_list){
-                    throw typeError("expected an arg list");
-                }
-                MalType* function_body = lst_elem[2];
-                if (!function_body){
-                    throw typeError("expected an function body");
-                }
+Env* Evaluator::repl_env = nullptr;
+const Symbol* const Evaluator::debug_eval_symbol = SymbolTable::intern("DEBUG-EVAL");
+bool Evaluator::debug_eval_global = false;
+bool Evaluator::debug_eval_scoped = false;
+Engine Evaluator::engine = Engine::Tree;
+
+bool Evaluator::truthy(MalType* value) {
+    // nil, true and false exist only as their canonical instances, so identity decides.
+    return value && value != MalNil::instance() && value != MalBool::instance(false);
+}
 
-                std::vector<std::string> eval_args_list;
-                for (const auto e: args_list->get_elem()){
-                    const auto sym = dynamic_cast<MalSymbol*>(e);
-                    if (!sym){
-                        throw typeError("expected a symbol");
-                    }
-                    eval_args_list.emplace_back(sym->name());
-                }
+void Evaluator::bind(Env* env, const MalSymbol* symbol, MalType* value) {
+    env->set(symbol->id(), value);
+    if (symbol->id() != debug_eval_symbol) {
+        return;
+    }
+    if (env->is_global()) {
+        debug_eval_global = truthy(value);
+    } else {
+        debug_eval_scoped = true;
+    }
+}
 
-                const auto local_env = new Env(env, false);
-                return new MalFunction(args_list, function_body, local_env);
-            }
+bool Evaluator::debug_eval_enabled(Env* env) {
+    return debug_eval_scoped ? truthy(env->get(debug_eval_symbol)) : debug_eval_global;
+}
+
+DebugEvalScope::DebugEvalScope() : scoped_(Evaluator::debug_eval_scoped) {}
+
+DebugEvalScope::~DebugEvalScope() {
+    Evaluator::debug_eval_scoped = this->scoped_;
+}
+
+MalType* Evaluator::eval(MalType *input, Env* env) {
+    if (engine == Engine::VM) {
+        return VM::run(Analyzer::analyze(input), env);
+    }
+    return exec(Analyzer::analyze(input), env);
+}
 
-            if (first_sym && first_sym->name() == "do"){
-                if (lst_elem.size() == 1){
-                    return new MalNil;
+MalType* Evaluator::exec(MalType *input, Env* env) {
+    DebugEvalScope debug_eval;
+    GCRootScope roots;
+    GC::add_root(&input);
+    GC::add_root(&env);
+
+    while (true){
+        GC::safepoint();
+
+        if ((debug_eval_global || debug_eval_scoped) && debug_eval_enabled(env)) {
+            Output::write("EVAL: " + input->to_string(true) + "\n");
+        }
+
+        switch (input->kind()){
+            case MalKind::Local: {
+                const auto local = cast<MalLocal>(input);
+                if (MalType* value = env->get_slot(local->depth(), local->slot())){
+                    return value;
                 }
-                for(size_t i = 1; i < lst_elem.size() - 1; i++){
-                    eval(lst_elem[i], env);
+                if (!local->fallback()){
+                    throw typeError("'" + local->symbol()->name() + "'" + " not found.");
                 }
-                input = lst_elem.back();
+                input = local->fallback();
                 continue;
             }
 
-            if (first_sym && first_sym->name() == "if"){
-                if (lst_elem.size() != 3 && lst_elem.size() != 4){
-                    throw syntaxError("expected 2 or 3 args, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
-                }
-                MalType* cond = eval(lst_elem[1], env);
-                const bool truthy = (!dynamic_cast<MalBool*>(cond) || dynamic_cast<MalBool*>(cond)->get_elem())
-                                    && !dynamic_cast<MalNil*>(cond);
-                if (truthy) {
-                    input = lst_elem[2];
-                } else if (lst_elem.size() == 4){
-                    input = lst_elem[3];
-                } else{
-                    return new MalNil;
+            case MalKind::Symbol: {
+                const auto sym = cast<MalSymbol>(input);
+                MalType* opt = env->get(sym->id());
+                if (!opt){
+                    throw typeError("'" + sym->name() + "'" + " not found.");
                 }
-                continue;
+                return opt;
             }
 
-            if (first_sym && first_sym->name() == "def!"){
-                if (lst_elem.size() != 3){
-                    throw syntaxError("expected 2 args, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
-                }
-                if (!dynamic_cast<MalSymbol*>(lst_elem[1])){
-                    throw syntaxError("expected a symbol");
+            case MalKind::List: {
+                const auto lst = cast<MalList>(input);
+                const auto& lst_elem = lst->get_elem();
+                if (lst_elem.empty()){
+                    return lst;
                 }
 
-                const auto symbol = dynamic_cast<MalSymbol*>(lst_elem[1]);
-                const auto name = symbol->name();
-                MalType* value = eval(lst_elem[2], env);
-                env->set(name, value);
+                const auto first = lst_elem[0];
+                const auto first_sym = dyn_cast<MalSymbol>(first);
+                switch (first_sym ? first_sym->special() : SpecialForm::None){
+                    case SpecialForm::Fn: {
+                        if (lst_elem.size() != 3){
+                            throw syntaxError("expected 2 args, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                        }
+
+                        const auto args_list = dyn_cast<MalSequence>(lst_elem[1]);
+                        if (!args_list){
+                            throw typeError("expected an arg list");
+                        }
+                        MalType* function_body = lst_elem[2];
+                        if (!function_body){
+                            throw typeError("expected an function body");
+                        }
+
+                        return MalFunction::closure(args_list, function_body, env);
+                    }
 
-                return value;
-            }
-            if (first_sym && first_sym->name() == "let*"){
-                if (lst_elem.size() != 3){
-                    throw syntaxError("expected 2 args, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
-                }
+                    case SpecialForm::Do: {
+                        if (lst_elem.size() == 1){
+                            return MalNil::instance();
+                        }
+                        for(size_t i = 1; i < lst_elem.size() - 1; i++){
+                            exec(lst_elem[i], env);
+                        }
+                        input = lst_elem.back();
+                        continue;
+                    }
 
-                const auto binding_sequence = dynamic_cast<MalSequence*>(lst_elem[1]);
-                if (!binding_sequence){
-                    throw syntaxError("expected a list or a vector for binding-list of let*");
-                }
+                    case SpecialForm::If: {
+                        if (lst_elem.size() != 3 && lst_elem.size() != 4){
+                            throw syntaxError("expected 2 or 3 args, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                        }
+                        MalType* cond = exec(lst_elem[1], env);
+                        if (Evaluator::truthy(cond)) {
+                            input = lst_elem[2];
+                        } else if (lst_elem.size() == 4){
+                            input = lst_elem[3];
+                        } else{
+                            return MalNil::instance();
+                        }
+                        continue;
+                    }
 
-                if (binding_sequence->get_elem().size() % 2 != 0){
-                    throw syntaxError("expected a value for a symbol to bind");
-                }
+                    case SpecialForm::Def: {
+                        if (lst_elem.size() != 3){
+                            throw syntaxError("expected 2 args, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                        }
+                        const auto symbol = dyn_cast<MalSymbol>(lst_elem[1]);
+                        const auto local = dyn_cast<MalLocal>(lst_elem[1]);
+                        if (!symbol && !local){
+                            throw syntaxError("expected a symbol");
+                        }
+
+                        MalType* value = exec(lst_elem[2], env);
+                        if (local){
+                            env->set_slot(local->slot(), value);
+                        } else {
+                            bind(env, symbol, value);
+                        }
+
+                        return value;
+                    }
 
-                Env* let_env = new Env(env, false);
-                for (std::size_t i = 0; i < binding_sequence->get_elem().size(); i += 2){
-                    const auto symbol = dynamic_cast<MalSymbol*>(binding_sequence->get_elem()[i]);
-                    if (!symbol) throw syntaxError("let* binding name must be symbol");
-                    const auto value = eval(binding_sequence->get_elem()[i + 1], let_env);
-                    let_env->set(symbol->name(), value);
-                }
+                    case SpecialForm::Let: {
+                        if (lst_elem.size() != 3){
+                            throw syntaxError("expected 2 args, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                        }
+
+                        const auto binding_sequence = dyn_cast<MalSequence>(lst_elem[1]);
+                        if (!binding_sequence){
+                            throw syntaxError("expected a list or a vector for binding-list of let*");
+                        }
+
+                        if (binding_sequence->size() % 2 != 0){
+                            throw syntaxError("expected a value for a symbol to bind");
+                        }
+
+                        env = new Env(env, false);
+                        for (std::size_t i = 0; i < binding_sequence->size(); i += 2){
+                            const auto local = dyn_cast<MalLocal>(binding_sequence->nth(i));
+                            const auto symbol = dyn_cast<MalSymbol>(binding_sequence->nth(i));
+                            if (!local && !symbol) throw syntaxError("let* binding name must be symbol");
+                            const auto value = exec(binding_sequence->nth(i + 1), env);
+                            if (local){
+                                env->set_slot(local->slot(), value);
+                            } else {
+                                bind(env, symbol, value);
+                            }
+                        }
+
+                        input = lst_elem[2];
+                        continue;
+                    }
 
-                input = lst_elem[2];
-                env = let_env;
-                continue;
-            }
+                    case SpecialForm::Quote: {
+                        if (lst_elem.size() != 2) {
+                            throw syntaxError("expected 1 arg, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                        }
+                        return lst_elem[1];
+                    }
+
+                    case SpecialForm::QuasiQuote: {
+                        if (lst_elem.size() != 2) {
+                            throw syntaxError("expected 1 arg, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                        }
+                        return quasiquote(lst_elem[1]);
+                    }
+
+                    case SpecialForm::UnQuote: {
+                        if (lst_elem.size() != 2) {
+                            throw syntaxError("expected 1 arg, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                        }
+                        return new MalUnQuote(lst_elem[1]);
+                    }
 
-            if (first_sym && first_sym->name() == "quote"){
-                if (lst_elem.size() != 2) {
-                    throw syntaxError("expected 1 arg, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                    case SpecialForm::SpliceUnQuote: {
+                        if (lst_elem.size() < 2) {
+                            throw syntaxError("expected at least 1 arg, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                        }
+                        return new MalUnQuoteSplicing(lst_elem[1]);
+                    }
+
+                    case SpecialForm::None:
+                        break;
                 }
-                return lst_elem[1];
-            }
 
-            if (first_sym && first_sym->name() == "quasiquote"){
-                if (lst_elem.size() != 2) {
-                    throw syntaxError("expected 1 arg, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                // A closure's arguments are copied into its Env, so the frame closes before the tail call goes on.
+                const ArgFrame frame(lst_elem.size());
+                const auto eval_params = frame.slots();
+                for (std::size_t i = 0; i < lst_elem.size(); ++i){
+                    eval_params[i] = exec(lst_elem[i], env);
                 }
-                return quasiquote(lst_elem[1]);
-            }
 
-            if (first_sym && first_sym->name() == "unquote"){
-                if (lst_elem.size() != 2) {
-                    throw syntaxError("expected 1 arg, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+                const auto fn = dyn_cast<MalFunction>(eval_params[0]);
+                if (!fn){
+                    throw typeError(eval_params[0]->to_string(true) + " is not a function");
+                }
+                const auto fn_args = std::span<MalType* const>(eval_params).subspan(1);
+                if (fn->is_builtin_func()){
+                    return fn->apply(fn_args);
                 }
-                return new MalUnQuote(lst_elem[1]);
+                env = fn->make_env(fn_args);
+                input = fn->get_body();
+                continue;
             }
 
-            if (first_sym && first_sym->name() == "splice-unquote"){
-                if (lst_elem.size() < 2) {
-                    throw syntaxError("expected at least 1 arg, but given " + std::to_string(lst_elem.size() - 1) + "arg(s)");
+            case MalKind::Vector: {
+                const auto vec = cast<MalVector>(input);
+                const ArgFrame frame(vec->size());
+                const auto eval_params = frame.slots();
+                std::size_t i = 0;
+                for (const auto arg: *vec){
+                    eval_params[i++] = exec(arg, env);
                 }
-                return new MalUnQuoteSplicing(lst_elem[1]);
+                return new MalVector(eval_params);
             }
 
-            std::vector<MalType*> eval_params;
-            for (auto& arg: lst_elem){
-                eval_params.emplace_back(eval(arg, env));
+            case MalKind::Map: {
+                const auto map = cast<MalMap>(input);
+                const ArgFrame frame(map->get_elem().size());
+                const auto eval_params = frame.slots();
+                std::size_t i = 0;
+                for (const auto e: map->get_elem()){
+                    eval_params[i++] = exec(e->value(), env);
+                }
+                Hamt eval_args;
+                auto value = eval_params.begin();
+                for (const auto e: map->get_elem()){
+                    eval_args = eval_args.assoc(new MalPair{e->key(), *value++});
+                }
+                return new MalMap(eval_args);
             }
 
-            const auto fn = dynamic_cast<MalFunction*>(eval_params[0]);
-            if (!fn){
-                throw typeError(eval_params[0]->to_string(true) + " is not a function");
-            }
-            MalFunction::mal_func_args_list_type fn_params_list = std::vector(eval_params.begin() + 1, eval_params.end());
-            if (fn->is_builtin_func()){
-                return fn->apply(fn_params_list);
-            }
-            const auto& args_list_elems = fn->get_args_list()->get_elem();
-            const auto size = args_list_elems.size();
-            std::vector<std::string> args_names(size);
-            for (std::size_t i = 0; i < size; ++i){
-                const auto sym = dynamic_cast<MalSymbol*>(args_list_elems[i]);
-                if (!sym) {
-                    throw typeError("fn* parameters must be symbols");
+            case MalKind::Deref: {
+                const auto res = exec(cast<MalDeref>(input)->get(), env);
+                if (!isa<MalRef>(res)){
+                    throw valueError("Cannot deref a non-atom type");
                 }
-                args_names[i] = sym->name();
+                input = cast<MalRef>(res)->get();
+                continue;
             }
 
-            auto fn_env = fn->get_env();
-            auto fn_body = fn->get_body();
-            const auto local_env = new Env(fn_env, args_names, fn_params_list);
-            input = fn_body;
-            env = local_env;
-            continue;
-        }
+            case MalKind::Quote:
+                return cast<MalQuote>(input)->get();
 
-        if (const auto vec = dynamic_cast<MalVector*>(input); vec){
-            std::vector<MalType*> eval_args;
-            for (const auto& arg: vec->get_elem()){
-                eval_args.emplace_back(eval(arg, env));
-            }
-            return new MalVector(eval_args);
-        }
-
-        if (const auto map = dynamic_cast<MalMap*>(input); map){
-            std::set<MalPair*> eval_args;
-            for (auto& e: map->get_elem()){
-                eval_args.insert(new MalPair{e->key(), eval(e->value(), env)});
-            }
-            return new MalMap(eval_args);
-        }
+            case MalKind::QuasiQuote:
+                input = quasiquote(cast<MalQuasiQuote>(input)->get());
+                continue;
 
-        auto syntax = dynamic_cast<MalSyntaxQuote*>(input);
-        if (syntax){
-            if (dynamic_cast<MalDeref*>(syntax)){
-                auto expr = dynamic_cast<MalDeref*>(syntax)->get();
-                auto res = eval(expr, env);
-                if (!dynamic_cast<MalRef*>(res)){
-                    throw valueError("Cannot deref a non-atom type");
-                }
-                input = dynamic_cast<MalRef*>(res)->get();
-            } else if (dynamic_cast<MalQuote*>(syntax)){
-                return dynamic_cast<MalQuote*>(syntax)->get();
-            } else if (dynamic_cast<MalQuasiQuote*>(syntax)){
-                input = quasiquote(dynamic_cast<MalQuasiQuote*>(syntax)->get());
-            }
-            continue;
+            default:
+                return input;
         }
-
-        return input;
     }
 }
 
@@ -232,25 +357,44 @@ MalType* Evaluator::eval(MalType* input) {
     return eval(input, repl_env);
 }
 
+bool Evaluator::select_engine(const std::string_view option) {
+    constexpr std::string_view prefix = "--engine=";
+    if (!option.starts_with(prefix)) {
+        return false;
+    }
+    const auto name = option.substr(prefix.size());
+    if (name == "tree") {
+        engine = Engine::Tree;
+    } else if (name == "vm") {
+        engine = Engine::VM;
+    } else {
+        throw REPLError("unknown engine '" + std::string(name) + "', expected 'tree' or 'vm'");
+    }
+    return true;
+}
+
 void Evaluator::set_env(Env *env) {
+    if (!repl_env) {
+        GC::add_root(&repl_env);
+    }
     repl_env = env;
 }
 
 MalType* Evaluator::quasiquote(MalType* input) {
-    if (dynamic_cast<MalUnQuote*>(input)){
-        return dynamic_cast<MalUnQuote*>(input)->get();
+    if (isa<MalUnQuote>(input)){
+        return cast<MalUnQuote>(input)->get();
     }
 
-    auto sequence = dynamic_cast<MalSequence*>(input);
-    if (!sequence || sequence->get_elem().empty()){
+    auto sequence = dyn_cast<MalSequence>(input);
+    if (!sequence || sequence->empty()){
         return input;
     }
-    if (dynamic_cast<MalList*>(sequence)){
-        auto elems = sequence->get_elem();
+    if (const auto list = dyn_cast<MalList>(sequence)){
+        const auto& elems = list->get_elem();
         std::vector<MalType*> reversed = {elems.rbegin(), elems.rend()};
         auto res = new MalList{};
         for (const auto item: reversed){
-            auto splice = dynamic_cast<MalUnQuoteSplicing*>(item);
+            auto splice = dyn_cast<MalUnQuoteSplicing>(item);
             if (splice){
                 res = new MalList{
                         new MalSymbol("concat"),
@@ -268,12 +412,12 @@ MalType* Evaluator::quasiquote(MalType* input) {
         return res;
     }
 
-    if (auto vec = dynamic_cast<MalVector*>(input)) {
-        auto processed = quasiquote(new MalList({vec->get_elem()}));
+    if (auto vec = dyn_cast<MalVector>(input)) {
+        auto processed = quasiquote(new MalList(vec->to_vector()));
         return new MalList{ new MalSymbol("vec"), processed };
     }
 
-    if (dynamic_cast<MalSymbol*>(input) || dynamic_cast<MalMap*>(input)) {
+    if (isa<MalSymbol>(input) || isa<MalMap>(input)) {
         return new MalList{ new MalSymbol("quote"), input };
     }
 
@@ -1,15 +1,59 @@
 #ifndef EVALUATOR_H
 #define EVALUATOR_H
 
+#include <span>
+#include <string_view>
 #include "types.h"
 
+enum class Engine : uint8_t {
+    Tree,
+    VM,
+};
+
+// Argument slots for one call, taken from a stack shared by every call in progress, so a call allocates
+// nothing but the callee's Env. The slots are rooted and never move until the frame is destroyed, even when
+// nested calls open frames of their own, so they can be handed to a builtin as a span.
+class ArgFrame {
+    std::size_t segment_;
+    std::size_t base_;
+    std::size_t size_;
+public:
+    explicit ArgFrame(std::size_t size);
+    ~ArgFrame();
+    ArgFrame(const ArgFrame&) = delete;
+    ArgFrame& operator=(const ArgFrame&) = delete;
+    [[nodiscard]] std::span<MalType*> slots() const;
+};
+
 class Evaluator {
+    friend class DebugEvalScope;
+
     static Env* repl_env;
+    static const Symbol* const debug_eval_symbol;
+    static bool debug_eval_global;
+    static bool debug_eval_scoped;
+    static Engine engine;
 public:
+    static bool truthy(MalType* value);
+    static void bind(Env* env, const MalSymbol* symbol, MalType* value);
+    static bool debug_eval_enabled(Env* env);
+    static bool select_engine(std::string_view option);
     static MalType* eval(MalType* input, Env* env);
+    static MalType* exec(MalType* input, Env* env);
     static MalType* eval(MalType* input);
     static void set_env(Env* env);
     static MalType* quasiquote(MalType* input);
 };
 
+// A DEBUG-EVAL bound in a local environment turns on tracing for the evaluation that bound it. Held for the
+// length of one exec or VM run, this puts back whatever was in force before once it returns or throws.
+class DebugEvalScope {
+    bool scoped_;
+public:
+    DebugEvalScope();
+    ~DebugEvalScope();
+    DebugEvalScope(const DebugEvalScope&) = delete;
+    DebugEvalScope& operator=(const DebugEvalScope&) = delete;
+};
+
 #endif //EVALUATOR_H
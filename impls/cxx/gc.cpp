@@ -0,0 +1,366 @@
+#include "gc.h"
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <utility>
+#include "types.h"
+#include "env.h"
+
+namespace {
+    struct FreeChunk {
+        FreeChunk* next;
+    };
+
+    // Under AddressSanitizer every object goes to the global heap so a stale pointer is still caught.
+#ifdef __SANITIZE_ADDRESS__
+    constexpr bool pooling = false;
+#else
+    constexpr bool pooling = true;
+#endif
+    constexpr std::size_t pool_classes = GC::pool_max_bytes / GC::pool_granule;
+
+    struct Pool {
+        FreeChunk* free = nullptr;
+        std::byte* cursor = nullptr;
+        std::byte* limit = nullptr;
+    };
+
+    Pool pools[pool_classes];
+    // Slabs stay mapped for the life of the process; their chunks only move between objects and freelists.
+    std::vector<std::unique_ptr<std::byte[]>> slabs;
+
+    std::size_t pool_class(const std::size_t size) {
+        return (size + GC::pool_granule - 1) / GC::pool_granule - 1;
+    }
+}
+
+GCObject* GC::objects_ = nullptr;
+GCObject* GC::counted_ = nullptr;
+GCArena* GC::arena_ = nullptr;
+std::vector<const GCObject*> GC::gray_;
+std::vector<MalType* const*> GC::value_roots_;
+std::vector<Env* const*> GC::env_roots_;
+std::vector<const std::vector<MalType*>*> GC::vector_roots_;
+std::vector<const GCRootSet*> GC::set_roots_;
+std::size_t GC::next_collection_bytes_ = GC::min_collection_bytes;
+GCStats GC::stats_;
+
+GCObject::GCObject() {
+    if (GC::arena_ && GC::arena_->claim(this)) {
+        GC::arena_->members_.push_back(this);
+        this->gc_next_ = GC::arena_;
+        this->arena_member_ = true;
+    } else {
+        this->gc_next_ = GC::objects_;
+        if (GC::objects_) {
+            GC::objects_->gc_prev_ = this;
+        }
+        GC::objects_ = this;
+    }
+    this->linked_ = true;
+    ++GC::stats_.heap_objects;
+}
+
+GCObject::GCObject(const GCObject&) : GCObject() {}
+
+GCObject& GCObject::operator=(const GCObject&) {
+    return *this;
+}
+
+GCObject::~GCObject() {
+    if (this->linked_) {
+        GC::unlink(this);
+    }
+    GC::stats_.heap_bytes -= this->owned_bytes_;
+    --GC::stats_.heap_objects;
+}
+
+void GCObject::trace() const {}
+
+std::size_t GCObject::owned_bytes() const {
+    return 0;
+}
+
+void* GCObject::operator new(const std::size_t size) {
+    if (GC::arena_) {
+        return GC::arena_->allocate(size);
+    }
+    GC::stats_.heap_bytes += size;
+    if (!pooling || size > GC::pool_max_bytes) {
+        ++GC::stats_.unpooled_allocs;
+        return ::operator new(size);
+    }
+    auto& pool = pools[pool_class(size)];
+    if (pool.free) {
+        ++GC::stats_.pool_hits;
+        return std::exchange(pool.free, pool.free->next);
+    }
+    ++GC::stats_.pool_misses;
+    const std::size_t chunk = (pool_class(size) + 1) * GC::pool_granule;
+    if (pool.cursor == pool.limit) {
+        slabs.emplace_back(new std::byte[GC::pool_slab_bytes]);
+        pool.cursor = slabs.back().get();
+        pool.limit = pool.cursor + GC::pool_slab_bytes / chunk * chunk;
+        GC::stats_.pool_slab_bytes += GC::pool_slab_bytes;
+    }
+    return std::exchange(pool.cursor, pool.cursor + chunk);
+}
+
+void GCObject::operator delete(void* ptr, const std::size_t size) {
+    if (GC::arena_ && GC::arena_->claim(ptr)) {
+        // A constructor threw inside an arena, before or after the object joined it; its bytes stay in the block.
+        return;
+    }
+    GC::stats_.heap_bytes -= size;
+    if (!pooling || size > GC::pool_max_bytes) {
+        ::operator delete(ptr);
+        return;
+    }
+    auto& pool = pools[pool_class(size)];
+    pool.free = new (ptr) FreeChunk{pool.free};
+}
+
+GCArena::GCArena() {
+    this->is_arena_ = true;
+}
+
+GCArena::~GCArena() {
+    for (const auto member: this->members_) {
+        member->linked_ = false;
+        member->~GCObject();
+    }
+    GC::stats_.heap_bytes -= this->bytes_;
+}
+
+void* GCArena::allocate(std::size_t size) {
+    constexpr std::size_t align = alignof(std::max_align_t);
+    size = (size + align - 1) & ~(align - 1);
+    if (static_cast<std::size_t>(this->limit_ - this->cursor_) < size) {
+        const std::size_t bytes = std::max(size, block_size);
+        this->blocks_.emplace_back(new std::byte[bytes]);
+        this->cursor_ = this->blocks_.back().get();
+        this->limit_ = this->cursor_ + bytes;
+        this->bytes_ += bytes;
+        GC::stats_.heap_bytes += bytes;
+    }
+    void* ptr = this->cursor_;
+    this->cursor_ += size;
+    this->pending_.push_back(ptr);
+    return ptr;
+}
+
+bool GCArena::claim(const void* ptr) {
+    const auto it = std::find(this->pending_.rbegin(), this->pending_.rend(), ptr);
+    if (it == this->pending_.rend()) {
+        return false;
+    }
+    this->pending_.erase(std::next(it).base());
+    return true;
+}
+
+// A member whose constructor threw goes back to pending, so operator delete leaves its slot in the block.
+void GCArena::release(GCObject* member) {
+    const auto it = std::find(this->members_.rbegin(), this->members_.rend(), member);
+    this->members_.erase(std::next(it).base());
+    this->pending_.push_back(member);
+}
+
+void GCArena::unmark_members() const {
+    for (const auto member: this->members_) {
+        member->marked_ = false;
+    }
+}
+
+std::size_t GCArena::size() const {
+    return this->members_.size();
+}
+
+void* GCArena::operator new(const std::size_t size) {
+    GC::stats_.heap_bytes += size;
+    return ::operator new(size);
+}
+
+void GCArena::operator delete(void* ptr, const std::size_t size) {
+    GC::stats_.heap_bytes -= size;
+    ::operator delete(ptr);
+}
+
+GCArenaScope::GCArenaScope() : previous_(GC::arena_) {
+    GC::arena_ = new GCArena;
+}
+
+GCArenaScope::~GCArenaScope() {
+    GC::arena_ = this->previous_;
+}
+
+GCHeapScope::GCHeapScope() : arena_(GC::arena_) {
+    GC::arena_ = nullptr;
+}
+
+GCHeapScope::~GCHeapScope() {
+    GC::arena_ = this->arena_;
+}
+
+void GC::mark(const GCObject* obj) {
+    if (!obj || obj->marked_) {
+        return;
+    }
+    const_cast<GCObject*>(obj)->marked_ = true;
+    gray_.push_back(obj);
+    if (obj->arena_member_) {
+        mark(obj->gc_next_);
+    }
+}
+
+void GC::add_root(MalType* const* slot) {
+    value_roots_.push_back(slot);
+}
+
+void GC::add_root(Env* const* slot) {
+    env_roots_.push_back(slot);
+}
+
+void GC::add_root(const std::vector<MalType*>* values) {
+    vector_roots_.push_back(values);
+}
+
+void GC::add_root(const GCRootSet* roots) {
+    set_roots_.push_back(roots);
+}
+
+// Only for objects the sweep did not free, such as one whose constructor threw.
+void GC::unlink(GCObject* obj) {
+    if (obj->arena_member_) {
+        static_cast<GCArena*>(obj->gc_next_)->release(obj);
+        return;
+    }
+    if (obj == counted_) {
+        counted_ = obj->gc_next_;
+    }
+    if (obj->gc_prev_) {
+        obj->gc_prev_->gc_next_ = obj->gc_next_;
+    } else {
+        objects_ = obj->gc_next_;
+    }
+    if (obj->gc_next_) {
+        obj->gc_next_->gc_prev_ = obj->gc_prev_;
+    }
+}
+
+// Brings heap_bytes up to date with what the object, or each member of an arena, holds outside itself.
+void GC::count_owned(GCObject* obj) {
+    if (obj->is_arena_) {
+        for (const auto member: static_cast<GCArena*>(obj)->members_) {
+            count_owned(member);
+        }
+        return;
+    }
+    const auto owned = static_cast<uint32_t>(std::min<std::size_t>(obj->owned_bytes(), UINT32_MAX));
+    stats_.heap_bytes += owned;
+    stats_.heap_bytes -= obj->owned_bytes_;
+    obj->owned_bytes_ = owned;
+}
+
+// New objects go on the front of the list, so the ones not yet counted are those ahead of counted_.
+void GC::count_new_objects() {
+    for (GCObject* obj = objects_; obj != counted_; obj = obj->gc_next_) {
+        count_owned(obj);
+    }
+    counted_ = objects_;
+}
+
+void GC::mark_roots() {
+    for (const auto slot: value_roots_) {
+        mark(*slot);
+    }
+    for (const auto slot: env_roots_) {
+        mark(*slot);
+    }
+    for (const auto values: vector_roots_) {
+        for (const auto value: *values) {
+            mark(value);
+        }
+    }
+    for (const auto roots: set_roots_) {
+        roots->trace();
+    }
+}
+
+void GC::drain() {
+    while (!gray_.empty()) {
+        const GCObject* obj = gray_.back();
+        gray_.pop_back();
+        obj->trace();
+    }
+}
+
+// Survivors have their owned bytes counted afresh, since an object such as an Env can grow after it is made.
+void GC::sweep() {
+    GCObject** link = &objects_;
+    GCObject* prev = nullptr;
+    while (*link) {
+        GCObject* obj = *link;
+        if (obj->marked_) {
+            obj->marked_ = false;
+            if (obj->is_arena_) {
+                static_cast<GCArena*>(obj)->unmark_members();
+            }
+            count_owned(obj);
+            prev = obj;
+            link = &obj->gc_next_;
+        } else {
+            *link = obj->gc_next_;
+            if (obj->gc_next_) {
+                obj->gc_next_->gc_prev_ = prev;
+            }
+            obj->linked_ = false;
+            if (obj->is_arena_) {
+                stats_.freed_objects += static_cast<GCArena*>(obj)->size();
+            }
+            delete obj;
+            ++stats_.freed_objects;
+        }
+    }
+}
+
+void GC::safepoint() {
+    count_new_objects();
+    if (stats_.heap_bytes >= next_collection_bytes_) {
+        collect();
+    }
+}
+
+void GC::collect() {
+    const auto start = std::chrono::steady_clock::now();
+
+    mark_roots();
+    drain();
+    sweep();
+    counted_ = objects_;
+
+    next_collection_bytes_ = std::max(min_collection_bytes, 2 * stats_.heap_bytes);
+
+    const auto pause = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    ++stats_.collections;
+    stats_.last_pause_us = pause;
+    stats_.max_pause_us = std::max(stats_.max_pause_us, static_cast<int64_t>(pause));
+    stats_.total_pause_us += pause;
+}
+
+const GCStats& GC::stats() {
+    return stats_;
+}
+
+GCRootScope::GCRootScope()
+    : values_(GC::value_roots_.size()),
+      envs_(GC::env_roots_.size()),
+      vectors_(GC::vector_roots_.size()),
+      sets_(GC::set_roots_.size()) {}
+
+GCRootScope::~GCRootScope() {
+    GC::value_roots_.resize(values_);
+    GC::env_roots_.resize(envs_);
+    GC::vector_roots_.resize(vectors_);
+    GC::set_roots_.resize(sets_);
+}
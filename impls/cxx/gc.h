@@ -0,0 +1,172 @@
+#ifndef GC_H
+#define GC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class MalType;
+class Env;
+class GCArena;
+
+class GCObject {
+    friend class GC;
+    friend class GCArena;
+    // Heap objects chain through gc_next_ and gc_prev_, so one can be unlinked in O(1); an arena member points
+    // gc_next_ at its arena instead and leaves gc_prev_ null.
+    GCObject* gc_next_ = nullptr;
+    GCObject* gc_prev_ = nullptr;
+    // What owned_bytes() returned when the collector last counted this object into heap_bytes.
+    uint32_t owned_bytes_ = 0;
+    // The flags share one byte, leaving the tail padding to the kind tag of a MalType.
+    bool marked_ : 1 = false;
+    bool arena_member_ : 1 = false;
+    bool is_arena_ : 1 = false;
+    // On the heap list, or among its arena's members, until the collector lets it go. Still set in the
+    // destructor when a derived constructor threw or the object lived on the stack, so the destructor unlinks it.
+    bool linked_ : 1 = false;
+public:
+    GCObject();
+    GCObject(const GCObject&);
+    GCObject& operator=(const GCObject&);
+    virtual ~GCObject();
+    virtual void trace() const;
+    // Bytes held outside the object itself, such as a container's buffer. The collector counts them toward
+    // the next collection when it first sees the object at a safepoint, and again at every sweep it survives.
+    [[nodiscard]] virtual std::size_t owned_bytes() const;
+
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+};
+
+// Bump-allocated storage for objects that live and die together, such as the reader output for one form.
+// Members are marked and traced like any object, and marking one keeps the whole arena alive; once none is
+// reachable the collector destroys them all and frees the blocks in one step.
+class GCArena final : public GCObject {
+    friend class GC;
+    friend class GCObject;
+
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    std::byte* cursor_ = nullptr;
+    std::byte* limit_ = nullptr;
+    std::size_t bytes_ = 0;
+    std::vector<GCObject*> members_;
+    // Allocated but not yet constructed: `new T(read_form(...))` may allocate T before reading its arguments.
+    std::vector<const void*> pending_;
+
+    void* allocate(std::size_t size);
+    bool claim(const void* ptr);
+    void release(GCObject* member);
+    void unmark_members() const;
+public:
+    constexpr static std::size_t block_size = 16 << 10;
+
+    GCArena();
+    GCArena(const GCArena&) = delete;
+    GCArena& operator=(const GCArena&) = delete;
+    ~GCArena() override;
+    [[nodiscard]] std::size_t size() const;
+
+    // An arena always lives on the heap, even when created inside another arena's scope.
+    static void* operator new(std::size_t size);
+    static void operator delete(void* ptr, std::size_t size);
+};
+
+// Sends every GCObject allocation made while it is alive into a fresh arena.
+class GCArenaScope {
+    GCArena* previous_;
+public:
+    GCArenaScope();
+    ~GCArenaScope();
+    GCArenaScope(const GCArenaScope&) = delete;
+    GCArenaScope& operator=(const GCArenaScope&) = delete;
+};
+
+// Sends allocations made while it is alive back to the heap, for objects that must outlive the current arena.
+class GCHeapScope {
+    GCArena* arena_;
+public:
+    GCHeapScope();
+    ~GCHeapScope();
+    GCHeapScope(const GCHeapScope&) = delete;
+    GCHeapScope& operator=(const GCHeapScope&) = delete;
+};
+
+class GCRootSet {
+public:
+    virtual ~GCRootSet() = default;
+    virtual void trace() const = 0;
+};
+
+struct GCStats {
+    std::size_t heap_objects = 0;
+    // Object sizes, arena blocks, and the owned_bytes() of every object the collector has counted so far.
+    std::size_t heap_bytes = 0;
+    std::size_t collections = 0;
+    std::size_t freed_objects = 0;
+    int64_t last_pause_us = 0;
+    int64_t max_pause_us = 0;
+    int64_t total_pause_us = 0;
+    // Heap allocations: recycled from a size-class freelist, carved from a fresh slab, or too big to pool.
+    std::size_t pool_hits = 0;
+    std::size_t pool_misses = 0;
+    std::size_t unpooled_allocs = 0;
+    std::size_t pool_slab_bytes = 0;
+};
+
+class GC {
+    friend class GCObject;
+    friend class GCArena;
+    friend class GCArenaScope;
+    friend class GCHeapScope;
+    friend class GCRootScope;
+
+    static GCObject* objects_;
+    // The newest object whose owned bytes are counted; everything allocated since sits in front of it.
+    static GCObject* counted_;
+    static GCArena* arena_;
+    static std::vector<const GCObject*> gray_;
+    static std::vector<MalType* const*> value_roots_;
+    static std::vector<Env* const*> env_roots_;
+    static std::vector<const std::vector<MalType*>*> vector_roots_;
+    static std::vector<const GCRootSet*> set_roots_;
+    static std::size_t next_collection_bytes_;
+    static GCStats stats_;
+
+    static void unlink(GCObject* obj);
+    static void count_owned(GCObject* obj);
+    static void count_new_objects();
+    static void mark_roots();
+    static void drain();
+    static void sweep();
+public:
+    constexpr static std::size_t min_collection_bytes = 8 << 20;
+    // Objects up to pool_max_bytes (ints, pairs, env frames, functions) come from per-size-class pools.
+    constexpr static std::size_t pool_granule = 16;
+    constexpr static std::size_t pool_max_bytes = 128;
+    constexpr static std::size_t pool_slab_bytes = 64 << 10;
+
+    static void mark(const GCObject* obj);
+    static void add_root(MalType* const* slot);
+    static void add_root(Env* const* slot);
+    static void add_root(const std::vector<MalType*>* values);
+    static void add_root(const GCRootSet* roots);
+    static void safepoint();
+    static void collect();
+    static const GCStats& stats();
+};
+
+class GCRootScope {
+    std::size_t values_;
+    std::size_t envs_;
+    std::size_t vectors_;
+    std::size_t sets_;
+public:
+    GCRootScope();
+    ~GCRootScope();
+    GCRootScope(const GCRootScope&) = delete;
+    GCRootScope& operator=(const GCRootScope&) = delete;
+};
+
+#endif //GC_H
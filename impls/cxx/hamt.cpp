@@ -0,0 +1,260 @@
+#include "hamt.h"
+#include <bit>
+#include "types.h"
+
+namespace {
+    bool is_collision(const unsigned shift) {
+        return shift >= Hamt::hash_bits;
+    }
+
+    uint32_t bit_for(const std::size_t hash, const unsigned shift) {
+        return 1u << ((hash >> shift) & ((1u << Hamt::bits) - 1));
+    }
+
+    std::size_t index_for(const HamtNode* node, const uint32_t bit) {
+        return static_cast<std::size_t>(std::popcount(node->bitmap & (bit - 1)));
+    }
+
+    bool same_key(const MalPair* entry, MalType* key) {
+        return entry->key() == key || entry->key()->equal(key);
+    }
+
+    // Smallest subtree holding two entries whose hashes agree on every slice above shift.
+    HamtNode* split(const unsigned shift, const std::size_t first_hash, MalPair* first,
+                    const std::size_t second_hash, MalPair* second) {
+        const auto node = new HamtNode;
+        if (is_collision(shift)) {
+            node->slots = {{first, nullptr}, {second, nullptr}};
+            return node;
+        }
+        const auto first_bit = bit_for(first_hash, shift);
+        const auto second_bit = bit_for(second_hash, shift);
+        if (first_bit == second_bit) {
+            node->bitmap = first_bit;
+            node->slots = {{nullptr, split(shift + Hamt::bits, first_hash, first, second_hash, second)}};
+            return node;
+        }
+        node->bitmap = first_bit | second_bit;
+        if (first_bit < second_bit) {
+            node->slots = {{first, nullptr}, {second, nullptr}};
+        } else {
+            node->slots = {{second, nullptr}, {first, nullptr}};
+        }
+        return node;
+    }
+
+    HamtNode* assoc_node(const HamtNode* node, const unsigned shift, const std::size_t hash,
+                         MalPair* entry, bool& added) {
+        const auto copy = node ? new HamtNode(*node) : new HamtNode;
+        if (is_collision(shift)) {
+            for (auto& slot: copy->slots) {
+                if (same_key(slot.entry, entry->key())) {
+                    slot.entry = entry;
+                    return copy;
+                }
+            }
+            copy->slots.push_back({entry, nullptr});
+            added = true;
+            return copy;
+        }
+
+        const auto bit = bit_for(hash, shift);
+        const auto index = index_for(copy, bit);
+        if (!(copy->bitmap & bit)) {
+            copy->bitmap |= bit;
+            copy->slots.insert(copy->slots.begin() + static_cast<std::ptrdiff_t>(index), {entry, nullptr});
+            added = true;
+            return copy;
+        }
+
+        auto& slot = copy->slots[index];
+        if (slot.child) {
+            slot.child = assoc_node(slot.child, shift + Hamt::bits, hash, entry, added);
+        } else if (same_key(slot.entry, entry->key())) {
+            slot.entry = entry;
+        } else {
+            slot = {nullptr, split(shift + Hamt::bits, slot.entry->key()->hash(), slot.entry, hash, entry)};
+            added = true;
+        }
+        return copy;
+    }
+
+    // Returns node itself when key is absent and nullptr once the node has no slots left.
+    HamtNode* dissoc_node(HamtNode* node, const unsigned shift, const std::size_t hash,
+                          MalType* key, bool& removed) {
+        if (is_collision(shift)) {
+            for (std::size_t i = 0; i < node->slots.size(); ++i) {
+                if (same_key(node->slots[i].entry, key)) {
+                    removed = true;
+                    if (node->slots.size() == 1) {
+                        return nullptr;
+                    }
+                    const auto copy = new HamtNode(*node);
+                    copy->slots.erase(copy->slots.begin() + static_cast<std::ptrdiff_t>(i));
+                    return copy;
+                }
+            }
+            return node;
+        }
+
+        const auto bit = bit_for(hash, shift);
+        if (!(node->bitmap & bit)) {
+            return node;
+        }
+        const auto index = index_for(node, bit);
+        const auto& slot = node->slots[index];
+        HamtNode* child = nullptr;
+        if (slot.child) {
+            child = dissoc_node(slot.child, shift + Hamt::bits, hash, key, removed);
+            if (!removed) {
+                return node;
+            }
+        } else if (same_key(slot.entry, key)) {
+            removed = true;
+        } else {
+            return node;
+        }
+
+        if (!child && node->slots.size() == 1) {
+            return nullptr;
+        }
+        const auto copy = new HamtNode(*node);
+        if (!child) {
+            copy->bitmap &= ~bit;
+            copy->slots.erase(copy->slots.begin() + static_cast<std::ptrdiff_t>(index));
+        } else if (child->slots.size() == 1 && !child->slots[0].child) {
+            // A lone entry moves up: its hash still selects this slot, so lookups stop here.
+            copy->slots[index] = child->slots[0];
+        } else {
+            copy->slots[index] = {nullptr, child};
+        }
+        return copy;
+    }
+}
+
+void HamtNode::trace() const {
+    for (const auto& slot: this->slots) {
+        GC::mark(slot.entry);
+        GC::mark(slot.child);
+    }
+}
+
+std::size_t HamtNode::owned_bytes() const {
+    return this->slots.capacity() * sizeof(Slot);
+}
+
+Hamt::Hamt() : root_(nullptr), size_(0) {}
+
+Hamt::Hamt(HamtNode* root, const std::size_t size) : root_(root), size_(size) {}
+
+std::size_t Hamt::size() const {
+    return this->size_;
+}
+
+bool Hamt::empty() const {
+    return this->size_ == 0;
+}
+
+MalPair* Hamt::find(MalType* key) const {
+    const auto hash = key->hash();
+    const HamtNode* node = this->root_;
+    for (unsigned shift = 0; node; shift += bits) {
+        if (is_collision(shift)) {
+            for (const auto& slot: node->slots) {
+                if (same_key(slot.entry, key)) {
+                    return slot.entry;
+                }
+            }
+            return nullptr;
+        }
+        const auto bit = bit_for(hash, shift);
+        if (!(node->bitmap & bit)) {
+            return nullptr;
+        }
+        const auto& slot = node->slots[index_for(node, bit)];
+        if (!slot.child) {
+            return same_key(slot.entry, key) ? slot.entry : nullptr;
+        }
+        node = slot.child;
+    }
+    return nullptr;
+}
+
+Hamt Hamt::assoc(MalPair* entry) const {
+    bool added = false;
+    const auto root = assoc_node(this->root_, 0, entry->key()->hash(), entry, added);
+    return {root, this->size_ + (added ? 1 : 0)};
+}
+
+Hamt Hamt::dissoc(MalType* key) const {
+    if (!this->root_) {
+        return *this;
+    }
+    bool removed = false;
+    const auto root = dissoc_node(this->root_, 0, key->hash(), key, removed);
+    return removed ? Hamt(root, this->size_ - 1) : *this;
+}
+
+Hamt::const_iterator Hamt::begin() const {
+    return const_iterator(this->root_);
+}
+
+Hamt::const_iterator Hamt::end() const {
+    return {};
+}
+
+void Hamt::trace() const {
+    GC::mark(this->root_);
+}
+
+Hamt::const_iterator::const_iterator(const HamtNode* root) {
+    if (root) {
+        this->nodes_[0] = root;
+        this->depth_ = 0;
+        this->settle();
+    }
+}
+
+void Hamt::const_iterator::settle() {
+    while (this->depth_ >= 0) {
+        const auto node = this->nodes_[this->depth_];
+        const auto index = this->index_[this->depth_];
+        if (index == node->slots.size()) {
+            if (--this->depth_ >= 0) {
+                ++this->index_[this->depth_];
+            }
+            continue;
+        }
+        const auto& slot = node->slots[index];
+        if (!slot.child) {
+            return;
+        }
+        ++this->depth_;
+        this->nodes_[this->depth_] = slot.child;
+        this->index_[this->depth_] = 0;
+    }
+}
+
+Hamt::const_iterator::reference Hamt::const_iterator::operator*() const {
+    return this->nodes_[this->depth_]->slots[this->index_[this->depth_]].entry;
+}
+
+Hamt::const_iterator& Hamt::const_iterator::operator++() {
+    ++this->index_[this->depth_];
+    this->settle();
+    return *this;
+}
+
+Hamt::const_iterator Hamt::const_iterator::operator++(int) {
+    const auto previous = *this;
+    ++*this;
+    return previous;
+}
+
+bool Hamt::const_iterator::operator==(const const_iterator& other) const {
+    if (this->depth_ != other.depth_) {
+        return false;
+    }
+    return this->depth_ < 0 || (this->nodes_[this->depth_] == other.nodes_[this->depth_] &&
+                                this->index_[this->depth_] == other.index_[this->depth_]);
+}
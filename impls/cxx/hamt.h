@@ -0,0 +1,74 @@
+#ifndef HAMT_H
+#define HAMT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+#include "gc.h"
+
+class MalType;
+class MalPair;
+
+// One trie level: a slot holds either an entry or a child node, packed by the bits set in bitmap.
+// Below the last 5-bit hash slice a node is a collision bucket, its slots all entries and bitmap unused.
+class HamtNode final : public GCObject {
+public:
+    struct Slot {
+        MalPair* entry;
+        HamtNode* child;
+    };
+
+    uint32_t bitmap = 0;
+    std::vector<Slot> slots;
+
+    void trace() const override;
+    [[nodiscard]] std::size_t owned_bytes() const override;
+};
+
+// Persistent hash array mapped trie keyed by MalType::hash().
+// Updates copy only the nodes on the path to the changed slot; iteration follows hash order.
+class Hamt {
+    HamtNode* root_;
+    std::size_t size_;
+
+    Hamt(HamtNode* root, std::size_t size);
+public:
+    static constexpr unsigned bits = 5;
+    static constexpr unsigned hash_bits = 64;
+    static constexpr std::size_t max_depth = (hash_bits + bits - 1) / bits + 1;
+
+    class const_iterator {
+        std::array<const HamtNode*, max_depth> nodes_{};
+        std::array<std::size_t, max_depth> index_{};
+        int depth_ = -1;
+
+        void settle();
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = MalPair*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = MalPair* const*;
+        using reference = MalPair* const&;
+
+        const_iterator() = default;
+        explicit const_iterator(const HamtNode* root);
+        reference operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        bool operator==(const const_iterator& other) const;
+    };
+
+    Hamt();
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] MalPair* find(MalType* key) const;
+    [[nodiscard]] Hamt assoc(MalPair* entry) const;
+    [[nodiscard]] Hamt dissoc(MalType* key) const;
+    [[nodiscard]] const_iterator begin() const;
+    [[nodiscard]] const_iterator end() const;
+    void trace() const;
+};
+
+#endif //HAMT_H
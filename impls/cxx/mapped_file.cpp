@@ -0,0 +1,43 @@
+#include "mapped_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "error.h"
+
+MappedFile::MappedFile(const char* data, const std::size_t size) : data_(data), size_(size) {}
+
+MappedFile* MappedFile::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw IOError("Can not open file: " + path);
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return nullptr;
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    void* data = nullptr;
+    if (size > 0) {
+        data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            return nullptr;
+        }
+        ::madvise(data, size, MADV_SEQUENTIAL);
+    }
+    // The mapping outlives the descriptor.
+    ::close(fd);
+    return new MappedFile(static_cast<const char*>(data), size);
+}
+
+MappedFile::~MappedFile() {
+    if (this->data_) {
+        ::munmap(const_cast<char*>(this->data_), this->size_);
+    }
+}
+
+std::string_view MappedFile::contents() const {
+    return {this->data_, this->size_};
+}
@@ -0,0 +1,25 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include "gc.h"
+
+// A read-only private mapping of a whole file. It is a collected object so strings sliced from it keep it
+// mapped; the collector unmaps it once nothing refers to it.
+class MappedFile final : public GCObject {
+    const char* data_;
+    std::size_t size_;
+
+    MappedFile(const char* data, std::size_t size);
+public:
+    // nullptr when path names something that cannot be mapped, such as a pipe; throws IOError if it cannot be opened.
+    static MappedFile* open(const std::string& path);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() override;
+    [[nodiscard]] std::string_view contents() const;
+};
+
+#endif //MAPPED_FILE_H
@@ -0,0 +1,55 @@
+#include "output.h"
+#include <cerrno>
+#include <string>
+#include <unistd.h>
+
+namespace {
+    // Whatever is still buffered is written when this is destroyed at exit.
+    struct StdoutBuffer {
+        std::string pending;
+        const bool interactive = ::isatty(STDOUT_FILENO) == 1;
+
+        StdoutBuffer() {
+            this->pending.reserve(Output::capacity);
+        }
+
+        ~StdoutBuffer() {
+            Output::flush();
+        }
+    };
+
+    StdoutBuffer stdout_buffer;
+}
+
+void Output::write(const std::string_view text) {
+    stdout_buffer.pending += text;
+    if (stdout_buffer.pending.size() >= capacity ||
+        (stdout_buffer.interactive && text.find('\n') != std::string_view::npos)) {
+        flush();
+    }
+}
+
+void Output::prompt(const std::string_view text) {
+    stdout_buffer.pending += text;
+    if (stdout_buffer.interactive) {
+        flush();
+    }
+}
+
+void Output::flush() {
+    const char* data = stdout_buffer.pending.data();
+    std::size_t left = stdout_buffer.pending.size();
+    while (left > 0) {
+        const auto written = ::write(STDOUT_FILENO, data, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Nowhere left to write to, such as a closed pipe; the output is dropped.
+            break;
+        }
+        data += written;
+        left -= static_cast<std::size_t>(written);
+    }
+    stdout_buffer.pending.clear();
+}
@@ -0,0 +1,20 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cstddef>
+#include <string_view>
+
+// Everything the interpreter prints to standard output goes through one buffer. On a terminal a newline
+// flushes it, as a line-buffered stream would; into a pipe or file it is written only when full, on flush()
+// and at exit, so piping many expressions through the REPL costs no write per result.
+class Output {
+public:
+    static constexpr std::size_t capacity = 64 * 1024;
+
+    static void write(std::string_view text);
+    // A prompt has no newline after it, so on a terminal it is flushed at once to be seen before input is read.
+    static void prompt(std::string_view text);
+    static void flush();
+};
+
+#endif //OUTPUT_H
@@ -1,5 +1,126 @@
 #include "printer.h"
+#include <array>
+#include <optional>
+#include <string_view>
+
+namespace {
+    // A structure whose opening text is written: the children left to print and the text that closes it.
+    struct Frame {
+        MalSequence::const_iterator next_element, end_element;
+        Hamt::const_iterator next_entry, end_entry;
+        std::array<const MalType*, 2> fixed{};
+        std::size_t next_fixed = 0;
+        std::size_t fixed_size = 0;
+        std::string_view close;
+        bool first = true;
+
+        const MalType* next() {
+            if (this->next_element != this->end_element) {
+                return *this->next_element++;
+            }
+            if (this->next_entry != this->end_entry) {
+                return *this->next_entry++;
+            }
+            if (this->next_fixed < this->fixed_size) {
+                return this->fixed[this->next_fixed++];
+            }
+            return nullptr;
+        }
+    };
+
+    Frame sequence_frame(const MalSequence* sequence, const std::string_view close) {
+        Frame frame;
+        frame.next_element = sequence->begin();
+        frame.end_element = sequence->end();
+        frame.close = close;
+        return frame;
+    }
+
+    Frame fixed_frame(const MalType* first, const MalType* second, const std::string_view close) {
+        Frame frame;
+        frame.fixed = {first, second};
+        frame.fixed_size = second ? 2 : 1;
+        frame.close = close;
+        return frame;
+    }
+
+    // Writes the opening text of a structure and returns its frame; an atom is written whole instead.
+    std::optional<Frame> open(std::string& out, const MalType* value, const bool print_readably) {
+        switch (value->kind()) {
+            case MalKind::List:
+                out += '(';
+                return sequence_frame(cast<MalList>(value), ")");
+            case MalKind::Vector:
+                out += '[';
+                return sequence_frame(cast<MalVector>(value), "]");
+            case MalKind::Map: {
+                out += '{';
+                const auto& entries = cast<MalMap>(value)->get_elem();
+                Frame frame;
+                frame.next_entry = entries.begin();
+                frame.end_entry = entries.end();
+                frame.close = "}";
+                return frame;
+            }
+            case MalKind::Pair: {
+                const auto pair = cast<MalPair>(value);
+                return fixed_frame(pair->key(), pair->value(), "");
+            }
+            case MalKind::Ref:
+                out += "(atom ";
+                return fixed_frame(cast<MalRef>(value)->get(), nullptr, ")");
+            case MalKind::Quote:
+                out += "(quote ";
+                return fixed_frame(cast<MalSyntaxQuote>(value)->get(), nullptr, ")");
+            case MalKind::QuasiQuote:
+                out += "(quasiquote ";
+                return fixed_frame(cast<MalSyntaxQuote>(value)->get(), nullptr, ")");
+            case MalKind::UnQuote:
+                out += "(unquote ";
+                return fixed_frame(cast<MalSyntaxQuote>(value)->get(), nullptr, ")");
+            case MalKind::UnQuoteSplicing:
+                out += "(splice-unquote ";
+                return fixed_frame(cast<MalSyntaxQuote>(value)->get(), nullptr, ")");
+            case MalKind::Deref:
+                out += "(deref ";
+                return fixed_frame(cast<MalSyntaxQuote>(value)->get(), nullptr, ")");
+            case MalKind::MetaSymbol: {
+                out += "(with-meta ";
+                const auto meta_symbol = cast<MalMetaSymbol>(value);
+                return fixed_frame(meta_symbol->get_value(), meta_symbol->get_meta(), ")");
+            }
+            default:
+                value->print(out, print_readably);
+                return std::nullopt;
+        }
+    }
+}
 
 std::string Printer::pr_str(const MalType* const mal_object, const bool print_readably) {
-    return mal_object->to_string(print_readably);
+    std::string out;
+    print(out, mal_object, print_readably);
+    return out;
+}
+
+void Printer::print(std::string& out, const MalType* mal_object, const bool print_readably) {
+    std::vector<Frame> frames;
+    while (mal_object) {
+        if (auto frame = open(out, mal_object, print_readably)) {
+            frames.push_back(*frame);
+        }
+        // Close every finished structure, then go on with the next child of the innermost open one.
+        mal_object = nullptr;
+        while (!frames.empty() && !mal_object) {
+            auto& top = frames.back();
+            if ((mal_object = top.next())) {
+                if (!top.first) {
+                    out += ' ';
+                }
+                top.first = false;
+            } else {
+                out += top.close;
+                frames.pop_back();
+            }
+        }
+    }
 }
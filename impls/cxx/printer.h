@@ -7,6 +7,9 @@
 class Printer {
 public:
     static std::string pr_str(const MalType* mal_object, bool print_readably = true);
+    // Appends mal_object to out. Structures are walked with an explicit stack of open frames, so nesting
+    // depth costs neither native stack nor intermediate strings; atoms write themselves via MalType::print.
+    static void print(std::string& out, const MalType* mal_object, bool print_readably = true);
 };
 
 #endif //PRINTER_H
@@ -0,0 +1,173 @@
+#include "pvector.h"
+#include <algorithm>
+#include <utility>
+#include "types.h"
+
+namespace {
+    std::size_t slot_for(const std::size_t index, const unsigned shift) {
+        return (index >> shift) & (PVector::width - 1);
+    }
+
+    PVectorNode* make_leaf(const std::span<MalType* const> values) {
+        const auto leaf = new PVectorNode;
+        leaf->values.assign(values.begin(), values.end());
+        return leaf;
+    }
+
+    // A chain of single-child nodes from shift down to leaf.
+    PVectorNode* new_path(const unsigned shift, PVectorNode* leaf) {
+        if (shift == 0) {
+            return leaf;
+        }
+        const auto node = new PVectorNode;
+        node->children.push_back(new_path(shift - PVector::bits, leaf));
+        return node;
+    }
+
+    // Copies the path to the slot for index size - 1, the full tail being moved in, and hangs leaf there.
+    PVectorNode* push_leaf(const PVectorNode* node, const unsigned shift, const std::size_t size, PVectorNode* leaf) {
+        const auto copy = node ? new PVectorNode(*node) : new PVectorNode;
+        const auto slot = slot_for(size - 1, shift);
+        PVectorNode* child = leaf;
+        if (shift > PVector::bits) {
+            const auto existing = slot < copy->children.size() ? copy->children[slot] : nullptr;
+            child = existing ? push_leaf(existing, shift - PVector::bits, size, leaf)
+                             : new_path(shift - PVector::bits, leaf);
+        }
+        if (slot < copy->children.size()) {
+            copy->children[slot] = child;
+        } else {
+            copy->children.push_back(child);
+        }
+        return copy;
+    }
+
+    PVectorNode* assoc_node(const PVectorNode* node, const unsigned shift, const std::size_t index, MalType* value) {
+        const auto copy = new PVectorNode(*node);
+        if (shift == 0) {
+            copy->values[slot_for(index, 0)] = value;
+        } else {
+            const auto slot = slot_for(index, shift);
+            copy->children[slot] = assoc_node(node->children[slot], shift - PVector::bits, index, value);
+        }
+        return copy;
+    }
+}
+
+void PVectorNode::trace() const {
+    for (const auto value: this->values) {
+        GC::mark(value);
+    }
+    for (const auto child: this->children) {
+        GC::mark(child);
+    }
+}
+
+std::size_t PVectorNode::owned_bytes() const {
+    return this->values.capacity() * sizeof(MalType*) + this->children.capacity() * sizeof(PVectorNode*);
+}
+
+PVector::PVector() : root_(nullptr), tail_(nullptr), size_(0), shift_(bits) {}
+
+PVector::PVector(PVectorNode* root, PVectorNode* tail, const std::size_t size, const unsigned shift)
+    : root_(root), tail_(tail), size_(size), shift_(shift) {}
+
+PVector::PVector(const std::span<MalType* const> elements) : PVector() {
+    if (elements.empty()) {
+        return;
+    }
+    this->size_ = elements.size();
+    const auto offset = this->tail_offset();
+    this->tail_ = make_leaf(elements.subspan(offset));
+
+    // Full leaves are built directly, then grouped 32 to a node until one node holds the rest.
+    std::vector<PVectorNode*> level;
+    for (std::size_t i = 0; i < offset; i += width) {
+        level.push_back(make_leaf(elements.subspan(i, width)));
+    }
+    if (level.empty()) {
+        return;
+    }
+    while (level.size() > width) {
+        std::vector<PVectorNode*> parents;
+        for (std::size_t i = 0; i < level.size(); i += width) {
+            const auto parent = new PVectorNode;
+            const auto end = std::min(level.size(), i + width);
+            parent->children.assign(level.begin() + static_cast<std::ptrdiff_t>(i),
+                                    level.begin() + static_cast<std::ptrdiff_t>(end));
+            parents.push_back(parent);
+        }
+        level = std::move(parents);
+        this->shift_ += bits;
+    }
+    this->root_ = new PVectorNode;
+    this->root_->children = std::move(level);
+}
+
+std::size_t PVector::tail_offset() const {
+    return this->size_ < width ? 0 : ((this->size_ - 1) >> bits) << bits;
+}
+
+const PVectorNode* PVector::leaf_for(const std::size_t index) const {
+    if (index >= this->tail_offset()) {
+        return this->tail_;
+    }
+    const PVectorNode* node = this->root_;
+    for (unsigned shift = this->shift_; shift > 0; shift -= bits) {
+        node = node->children[slot_for(index, shift)];
+    }
+    return node;
+}
+
+std::size_t PVector::size() const {
+    return this->size_;
+}
+
+bool PVector::empty() const {
+    return this->size_ == 0;
+}
+
+MalType* PVector::nth(const std::size_t index) const {
+    const auto offset = index >= this->tail_offset() ? this->tail_offset() : index & ~(width - 1);
+    return this->leaf_for(index)->values[index - offset];
+}
+
+std::span<MalType* const> PVector::chunk(const std::size_t index) const {
+    const auto offset = index >= this->tail_offset() ? this->tail_offset() : index & ~(width - 1);
+    return std::span<MalType* const>(this->leaf_for(index)->values).subspan(index - offset);
+}
+
+PVector PVector::conj(MalType* value) const {
+    if (this->size_ - this->tail_offset() < width) {
+        const auto tail = this->tail_ ? new PVectorNode(*this->tail_) : new PVectorNode;
+        tail->values.push_back(value);
+        return {this->root_, tail, this->size_ + 1, this->shift_};
+    }
+
+    // The tail is full: it moves into the trie, growing a new root level when the current one is full.
+    const auto tail = make_leaf(std::span<MalType* const>(&value, 1));
+    if ((this->size_ >> bits) > (std::size_t{1} << this->shift_)) {
+        const auto root = new PVectorNode;
+        root->children = {this->root_, new_path(this->shift_, this->tail_)};
+        return {root, tail, this->size_ + 1, this->shift_ + bits};
+    }
+    return {push_leaf(this->root_, this->shift_, this->size_, this->tail_), tail, this->size_ + 1, this->shift_};
+}
+
+PVector PVector::assoc(const std::size_t index, MalType* value) const {
+    if (index == this->size_) {
+        return this->conj(value);
+    }
+    const auto offset = this->tail_offset();
+    if (index >= offset) {
+        const auto tail = new PVectorNode(*this->tail_);
+        tail->values[index - offset] = value;
+        return {this->root_, tail, this->size_, this->shift_};
+    }
+    return {assoc_node(this->root_, this->shift_, index, value), this->tail_, this->size_, this->shift_};
+}
+
+void PVector::trace() const {
+    GC::mark(this->root_);
+    GC::mark(this->tail_);
+}
@@ -0,0 +1,48 @@
+#ifndef PVECTOR_H
+#define PVECTOR_H
+
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "gc.h"
+
+class MalType;
+
+// One trie level: a leaf holds up to 32 elements, an inner node up to 32 children.
+class PVectorNode final : public GCObject {
+public:
+    std::vector<MalType*> values;
+    std::vector<PVectorNode*> children;
+
+    void trace() const override;
+    [[nodiscard]] std::size_t owned_bytes() const override;
+};
+
+// Persistent bit-partitioned vector trie, 32-way, with the last partial leaf kept aside as the tail.
+// Appends copy only the tail until it fills; updates copy the path from the root to one leaf.
+class PVector {
+    PVectorNode* root_;
+    PVectorNode* tail_;
+    std::size_t size_;
+    unsigned shift_;
+
+    PVector(PVectorNode* root, PVectorNode* tail, std::size_t size, unsigned shift);
+    [[nodiscard]] std::size_t tail_offset() const;
+    [[nodiscard]] const PVectorNode* leaf_for(std::size_t index) const;
+public:
+    static constexpr unsigned bits = 5;
+    static constexpr std::size_t width = std::size_t{1} << bits;
+
+    PVector();
+    explicit PVector(std::span<MalType* const> elements);
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] MalType* nth(std::size_t index) const;
+    // The elements from index to the end of the leaf holding it.
+    [[nodiscard]] std::span<MalType* const> chunk(std::size_t index) const;
+    [[nodiscard]] PVector conj(MalType* value) const;
+    [[nodiscard]] PVector assoc(std::size_t index, MalType* value) const;
+    void trace() const;
+};
+
+#endif //PVECTOR_H
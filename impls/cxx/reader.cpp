@@ -1,34 +1,190 @@
 #include "reader.h"
 #include "error.h"
+#include <istream>
+#include <limits>
 #include <utility>
-#include <regex>
-
-auto Reader::tokenize(std::string input) -> std::vector<std::string> {
-    std::vector<std::string> tokens;
-    const std::regex tokens_pattern(token_pattern);
-    const std::sregex_iterator it_begin(input.begin(), input.end(), tokens_pattern);
-    const std::sregex_iterator it_end{};
-    for (auto it = it_begin; it != it_end; ++it) {
-        std::string token = it->str();
-        token.erase(0, token.find_first_not_of(" \t\n\r,"));
-        token.erase(token.find_last_not_of(" \t\n\r,") + 1);
 
-        if (!token.empty()) {
-            tokens.emplace_back(token);
+namespace {
+    bool is_blank(const char c) {
+        switch (c) {
+            case ' ': case '\t': case '\n': case '\r': case '\f': case '\v': case ',':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_line_end(const char c) {
+        return c == '\n' || c == '\r';
+    }
+
+    bool ends_symbol(const char c) {
+        switch (c) {
+            case '[': case ']': case '{': case '}': case '(': case ')':
+            case '\'': case '"': case '`': case ';':
+                return true;
+            default:
+                return is_blank(c);
+        }
+    }
+
+    // Scans the token at or after i and leaves i just past it; an empty view means input is exhausted.
+    // Blanks and commas separate tokens and ';' comments are dropped. An unterminated string runs to the end
+    // of input (or to a backslash at a line end), less trailing blanks, for read_atom to reject; open reports
+    // the end-of-input case, where a stream may still supply the rest.
+    std::string_view scan_token(const std::string_view input, std::size_t& i, bool& open) {
+        const std::size_t size = input.size();
+        open = false;
+        while (true) {
+            while (i < size && is_blank(input[i])) {
+                ++i;
+            }
+            if (i == size) {
+                return {};
+            }
+
+            const std::size_t start = i;
+            switch (input[i]) {
+                case '~':
+                    i += i + 1 < size && input[i + 1] == '@' ? 2 : 1;
+                    break;
+                case '[': case ']': case '{': case '}': case '(': case ')':
+                case '\'': case '`': case '^': case '@':
+                    ++i;
+                    break;
+                case '"':
+                    for (++i; i < size && input[i] != '"'; ++i) {
+                        if (input[i] == '\\') {
+                            if (i + 1 == size || is_line_end(input[i + 1])) {
+                                break;
+                            }
+                            ++i;
+                        }
+                    }
+                    if (i < size && input[i] == '"') {
+                        ++i;
+                        break;
+                    }
+                    open = i == size;
+                    while (i > start + 1 && (is_line_end(input[i - 1]) || input[i - 1] == ' ' ||
+                                             input[i - 1] == '\t' || input[i - 1] == ',')) {
+                        --i;
+                    }
+                    break;
+                case ';':
+                    while (i < size && !is_line_end(input[i])) {
+                        ++i;
+                    }
+                    continue;
+                default:
+                    while (i < size && !ends_symbol(input[i])) {
+                        ++i;
+                    }
+                    break;
+            }
+            return input.substr(start, i - start);
+        }
+    }
+}
+
+namespace {
+    bool is_digit(const char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // False when the token is not an optionally signed run of digits; an integer literal that does not fit
+    // in 64 bits is a syntax error. Digits accumulate as a negative number so the minimum parses exactly.
+    bool parse_int(const std::string_view token, int64_t& value) {
+        const bool negative = token[0] == '-';
+        std::size_t i = negative || token[0] == '+' ? 1 : 0;
+        if (i == token.size()) {
+            return false;
+        }
+        int64_t n = 0;
+        bool overflow = false;
+        for (; i < token.size(); ++i) {
+            if (!is_digit(token[i])) {
+                return false;
+            }
+            const int digit = token[i] - '0';
+            if (n < (std::numeric_limits<int64_t>::min() + digit) / 10) {
+                overflow = true;
+            } else {
+                n = n * 10 - digit;
+            }
+        }
+        if (overflow || (!negative && n == std::numeric_limits<int64_t>::min())) {
+            throw syntaxError("integer literal out of range: " + std::string(token));
         }
+        value = negative ? n : -n;
+        return true;
+    }
+
+    // Checks the escapes and the closing quote of a string token while unescaping it.
+    std::string parse_string(const std::string_view token) {
+        std::string result;
+        result.reserve(token.size());
+        for (std::size_t i = 1; i < token.size(); ++i) {
+            char c = token[i];
+            if (c == '"') {
+                if (i + 1 == token.size()) {
+                    return result;
+                }
+                break;
+            }
+            if (c == '\\') {
+                if (++i == token.size()) {
+                    break;
+                }
+                switch (token[i]) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case 'r': c = '\r'; break;
+                    case '"': case '\\': c = token[i]; break;
+                    default: throw syntaxError("expected closed string");
+                }
+            }
+            result += c;
+        }
+        throw syntaxError("expected closed string");
+    }
+}
+
+auto Reader::tokenize(const std::string_view input) -> std::vector<std::string_view> {
+    std::vector<std::string_view> tokens;
+    std::size_t i = 0;
+    bool open;
+    for (auto token = scan_token(input, i, open); !token.empty(); token = scan_token(input, i, open)) {
+        tokens.emplace_back(token);
     }
     return tokens;
 }
 
-auto Reader::read_str(std::string input) -> MalType* {
-    const auto tokens = tokenize(std::move(input));
-    Reader reader(tokens, 0);
+auto Reader::read_str(const std::string_view input) -> MalType* {
+    GCArenaScope arena;
+    Reader reader(input);
     return read_form(reader);
 }
 
+auto Reader::read_next(Reader& reader) -> MalType* {
+    if (!reader.hasNext()) {
+        return nullptr;
+    }
+    GCArenaScope arena;
+    MalType* form = read_form(reader);
+    reader.next();
+    reader.tokens_.erase(reader.tokens_.begin(), reader.tokens_.begin() + static_cast<std::ptrdiff_t>(reader.pos_));
+    if (reader.in_) {
+        reader.stream_tokens_.erase(reader.stream_tokens_.begin(),
+                                    reader.stream_tokens_.begin() + static_cast<std::ptrdiff_t>(reader.pos_));
+    }
+    reader.pos_ = 0;
+    return form;
+}
+
 auto Reader::read_form(Reader &reader) -> MalType* {
     if (reader.hasNext()) {
-        const std::string token = reader.peek();
+        const auto token = reader.peek();
         if (token == "(" || token == "[") {
             return read_struct(reader, token == "(" ? ")" : "]");
         }
@@ -41,14 +197,14 @@ auto Reader::read_form(Reader &reader) -> MalType* {
             return read_syntax_quote(reader, token);
         }
     }else {
-        return new MalNil();
+        return MalNil::instance();
     }
 
     return read_atom(reader);
 }
 
-auto Reader::read_struct(Reader &reader, const std::string& type) -> MalStruct* {
-    std::string token;
+auto Reader::read_struct(Reader &reader, const std::string_view type) -> MalStruct* {
+    std::string_view token;
 
     if (!reader.hasNext()) {
         throw syntaxError("unbalanced");
@@ -80,10 +236,10 @@ auto Reader::read_struct(Reader &reader, const std::string& type) -> MalStruct*
 }
 
 MalMap *Reader::read_map(Reader &reader) {
-    std::set<MalPair*> map;
+    const auto map = new MalMap;
     MalType* key = nullptr;
     MalType* value = nullptr;
-    std::string token;
+    std::string_view token;
 
     while (reader.hasNext()) {
         reader.next();
@@ -97,7 +253,7 @@ MalMap *Reader::read_map(Reader &reader) {
             key = read_form(reader);
         } else {
             value = read_form(reader);
-            map.insert(new MalPair{key, value});
+            map->put(key, value);
             key = nullptr;
         }
     }
@@ -105,14 +261,13 @@ MalMap *Reader::read_map(Reader &reader) {
     if (key != nullptr)
         throw syntaxError("unbalanced");
 
-    return new MalMap(map);
+    return map;
 }
 
-MalSyntaxQuote *Reader::read_syntax_quote(Reader &reader, const std::string &type) {
+MalSyntaxQuote *Reader::read_syntax_quote(Reader &reader, const std::string_view type) {
     if (!reader.hasNext()) {
         throw syntaxError("expected a symbol to bind");
     }
-    const auto token = reader.peek();
     reader.next();
     MalSyntaxQuote* quote = nullptr;
     if (type == "'"){
@@ -134,72 +289,75 @@ MalSyntaxQuote *Reader::read_syntax_quote(Reader &reader, const std::string &typ
     return quote;
 }
 
-auto Reader::read_atom(const Reader &reader) -> MalAtom* {
+auto Reader::read_atom(Reader &reader) -> MalAtom* {
     const auto token = reader.peek();
-    if (MalType::isInt(token)) {
-        return new MalInt(std::stoll(token));
-    }
-    if (MalType::isNil(token)) {
-        return new MalNil();
+    if (token.empty()) {
+        return new MalSymbol(token);
     }
-    if (MalType::isBool(token)) {
-        return new MalBool(token == "true");
-    }
-    if (!token.empty() && token[0] == '"') {
-        if (!MalType::isString(token)) {
-            throw syntaxError("expected closed string");
-        }
-            return new MalString(unescape_string(token));
+    // The first character settles the kind; only integers and strings need a scan of the rest.
+    switch (token[0]) {
+        case '"':
+            return new MalString(parse_string(token));
+        case ':':
+            return MalKeyword::intern(token.substr(1));
+        case 'n':
+            if (token == "nil") {
+                return MalNil::instance();
+            }
+            break;
+        case 't': case 'f':
+            if (token == "true" || token == "false") {
+                return MalBool::instance(token[0] == 't');
+            }
+            break;
+        default:
+            if (int64_t value; (is_digit(token[0]) || token[0] == '-' || token[0] == '+') && parse_int(token, value)) {
+                return MalInt::of(value);
+            }
+            break;
     }
-    if (MalType::isKeyword(token))
-        return new MalKeyword(token.substr(1));
-
     return new MalSymbol(token);
 }
 
-std::string Reader::unescape_string(const std::string& str)
-{
-    std::string result;
-    for (size_t i = 0; i < str.length(); ++i) {
-        if (str[i] == '\\' && i + 1 < str.length()) {
-            ++i;
-            switch (str[i]) {
-                case 'n': result += '\n'; break;
-                case 't': result += '\t'; break;
-                case 'r': result += '\r'; break;
-                case '"': result += '\"'; break;
-                case '\\': result += '\\'; break;
-                default: result += str[i];
-            }
-        } else {
-            result += str[i];
-        }
-    }
-    return result;
-}
+Reader::Reader(const std::string_view input) : input_(input), in_(nullptr), scan_(0), pos_(0) {}
+
+Reader::Reader(std::istream& in) : in_(&in), scan_(0), pos_(0) {}
 
-std::string Reader::remove_comments(const std::string &input) {
-    std::istringstream iss(input);
+bool Reader::scan_next_token() {
     std::string line;
-    std::string cleaned_input;
-    while (std::getline(iss, line)) {
-        auto comment_pos = line.find(';');
-        if (comment_pos != std::string::npos) {
-            line = line.substr(0, comment_pos);
+    while (true) {
+        bool open;
+        std::size_t end = this->scan_;
+        const auto token = scan_token(this->input_, end, open);
+        if (open && this->in_ && std::getline(*this->in_, line)) {
+            // The string goes on past this line: keep it and scan it again with the next line appended.
+            this->line_.erase(0, static_cast<std::size_t>(token.data() - this->line_.data()));
+            this->line_ += line;
+            this->line_ += '\n';
+            this->input_ = this->line_;
+            this->scan_ = 0;
+            continue;
+        }
+        if (!token.empty()) {
+            this->scan_ = end;
+            this->tokens_.emplace_back(this->in_ ? this->stream_tokens_.emplace_back(token) : token);
+            return true;
         }
-        cleaned_input += line + '\n';
+        if (!this->in_ || !std::getline(*this->in_, line)) {
+            return false;
+        }
+        this->line_ = std::move(line);
+        this->line_ += '\n';
+        this->input_ = this->line_;
+        this->scan_ = 0;
     }
-    return cleaned_input;
 }
 
-Reader::Reader(std::vector<std::string> tokens, const size_t pos)
-    : tokens_(std::move(tokens)), pos_(pos) {}
-
-auto Reader::peek() const -> std::string {
-    return tokens_[pos_];
+auto Reader::peek() -> std::string_view {
+    return this->hasNext() ? tokens_[pos_] : std::string_view();
 }
 
-auto Reader::next() -> std::string {
+auto Reader::next() -> std::string_view {
     if (!this->hasNext())
         return {};
 
@@ -208,7 +366,6 @@ auto Reader::next() -> std::string {
     return token;
 }
 
-auto Reader::hasNext() const -> bool {
-    return pos_ < tokens_.size();
+auto Reader::hasNext() -> bool {
+    return pos_ < tokens_.size() || this->scan_next_token();
 }
-
@@ -1,28 +1,42 @@
 #ifndef READER_H
 #define READER_H
+#include <deque>
+#include <istream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "types.h"
 
 class Reader {
-    constexpr static auto token_pattern = R"([\s,]*(~@|[\[\]{}()'`~^@]|"(?:\\.|[^\\"])*"?|;.*|[^\s\[\]{}('"`,;)]*))";
-
-    std::vector<std::string> tokens_;
+    // Tokens are scanned one at a time as the reader asks for them. A string source is viewed, never copied,
+    // so it must outlive the reader and the tokens are views into it. A stream source is read a line at a time
+    // into line_, and its tokens are copied into stream_tokens_. read_next drops a form's tokens once it is read.
+    std::string_view input_;
+    std::istream* in_;
+    std::string line_;
+    std::size_t scan_;
+    std::deque<std::string> stream_tokens_;
+    std::vector<std::string_view> tokens_;
     size_t pos_;
+
+    bool scan_next_token();
 public:
-    static std::vector<std::string> tokenize(std::string input);
-    static MalType* read_str(std::string input);
+    static std::vector<std::string_view> tokenize(std::string_view input);
+    static MalType* read_str(std::string_view input);
+    // Reads the form at the cursor and moves past it; nullptr once the input is exhausted.
+    static MalType* read_next(Reader& reader);
     static MalType* read_form(Reader& reader);
-    static MalStruct *read_struct(Reader &reader, const std::string &type);
+    static MalStruct *read_struct(Reader &reader, std::string_view type);
     static MalMap* read_map(Reader& reader);
-    static MalSyntaxQuote* read_syntax_quote(Reader &reader, const std::string &type);
-    static MalAtom* read_atom(const Reader &reader);
-    static std::string unescape_string(const std::string& str);
-    static std::string remove_comments(const std::string& input);
-    Reader(std::vector<std::string> tokens, size_t pos);
-    [[nodiscard]] std::string peek() const;
-    std::string next();
-    [[nodiscard]] bool hasNext() const;
+    static MalSyntaxQuote* read_syntax_quote(Reader &reader, std::string_view type);
+    static MalAtom* read_atom(Reader &reader);
+    explicit Reader(std::string_view input);
+    explicit Reader(std::istream& in);
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+    std::string_view peek();
+    std::string_view next();
+    bool hasNext();
 };
 
 #endif //READER_H
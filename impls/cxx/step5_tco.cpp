@@ -7,6 +7,7 @@
 #include "types.h"
 #include "printer.h"
 #include "env.h"
+#include "output.h"
 
 
 MalType* READ(std::string input){
@@ -21,21 +22,30 @@ std::string PRINT(const MalType* input) {
     return Printer::pr_str(input, true);
 }
 
-int main(){
+int main(int argc, char** argv){
+    try {
+        if (argc > 1) {
+            Evaluator::select_engine(argv[1]);
+        }
+    } catch (const liscppError& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
     Env global_env;
 
     while(true){
-        std::cout << "user> ";
+        Output::prompt("user> ");
         std::string input;
         if (!std::getline(std::cin, input)) {
-            std::cout << std::endl;
+            Output::write("\n");
             break;
         }try {
-            std::cout << PRINT(EVAL(READ(input), global_env)) << std::endl;
+            Output::write(PRINT(EVAL(READ(input), global_env)) + "\n");
         }catch(const syntaxError& e) {
-            std::cout << e.what() << std::endl;
+            Output::write(std::string(e.what()) + "\n");
         }catch(const typeError& e){
-            std::cout << e.what() << std::endl;
+            Output::write(std::string(e.what()) + "\n");
         }
     }
 
@@ -8,11 +8,12 @@
 #include "printer.h"
 #include "env.h"
 #include "builtin.h"
+#include "output.h"
 #include <cstdlib>
 
 
-MalType* READ(std::string input){
-    return Reader::read_str(std::move(input));
+MalType* READ(const std::string& input){
+    return Reader::read_str(input);
 }
 
 MalType* EVAL(MalType* input, Env& env) {
@@ -23,11 +24,11 @@ std::string PRINT(const MalType* input) {
     return Printer::pr_str(input, true);
 }
 
-void file_exec(char** argv){
-    auto path = std::string(argv[1]);
+void file_exec(const std::string& path){
     try {
-        load_file({new MalString(path)}, false);
+        load_file(new MalString(path));
     } catch (const std::exception& e) {
+        Output::flush();
         std::cerr << e.what() << std::endl;
         std::exit(1);
     }
@@ -35,30 +36,41 @@ void file_exec(char** argv){
 
 void repl(Env& global_env){
     while(true){
-        std::cout << "user> ";
+        Output::prompt("user> ");
         std::string input;
         if (!std::getline(std::cin, input)) {
-            std::cout << std::endl;
+            Output::write("\n");
             break;
         }try {
-            std::cout << PRINT(EVAL(READ(input), global_env)) << std::endl;
+            Output::write(PRINT(EVAL(READ(input), global_env)) + "\n");
         }catch(const liscppError& e) {
+            Output::flush();
             std::cerr << e.what() << std::endl;
         }
     }
 }
 
 int main(int argc, char** argv){
+    int arg = 1;
+    try {
+        if (arg < argc && Evaluator::select_engine(argv[arg])) {
+            ++arg;
+        }
+    } catch (const liscppError& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
     Env global_env;
     std::vector<MalType*> argv_list;
-    for (int i = 2; i < argc; ++i) {
+    for (int i = arg + 1; i < argc; ++i) {
         argv_list.push_back(new MalString(argv[i]));
     }
     global_env.set("*ARGV*", new MalList(argv_list));
     Evaluator::set_env(&global_env);
 
-    if (argc >= 2){
-        file_exec(argv);
+    if (arg < argc){
+        file_exec(argv[arg]);
     } else{
         repl(global_env);
     }
@@ -0,0 +1,41 @@
+#include "symbol.h"
+#include <utility>
+
+Symbol::Symbol(std::string name, const SpecialForm special)
+    : name_(std::move(name)), special_(special) {}
+
+const std::string& Symbol::name() const {
+    return this->name_;
+}
+
+SpecialForm Symbol::special() const {
+    return this->special_;
+}
+
+SpecialForm SymbolTable::special_form(const std::string_view name) {
+    if (name == "def!") return SpecialForm::Def;
+    if (name == "let*") return SpecialForm::Let;
+    if (name == "fn*") return SpecialForm::Fn;
+    if (name == "do") return SpecialForm::Do;
+    if (name == "if") return SpecialForm::If;
+    if (name == "quote") return SpecialForm::Quote;
+    if (name == "quasiquote") return SpecialForm::QuasiQuote;
+    if (name == "unquote") return SpecialForm::UnQuote;
+    if (name == "splice-unquote") return SpecialForm::SpliceUnQuote;
+    return SpecialForm::None;
+}
+
+std::unordered_map<std::string_view, const Symbol*>& SymbolTable::table() {
+    static std::unordered_map<std::string_view, const Symbol*> symbols;
+    return symbols;
+}
+
+const Symbol* SymbolTable::intern(const std::string_view name) {
+    auto& symbols = table();
+    if (const auto it = symbols.find(name); it != symbols.end()) {
+        return it->second;
+    }
+    const auto symbol = new Symbol(std::string(name), special_form(name));
+    symbols.emplace(symbol->name(), symbol);
+    return symbol;
+}
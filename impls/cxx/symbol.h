@@ -0,0 +1,40 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+enum class SpecialForm : uint8_t {
+    None,
+    Def,
+    Let,
+    Fn,
+    Do,
+    If,
+    Quote,
+    QuasiQuote,
+    UnQuote,
+    SpliceUnQuote,
+};
+
+class Symbol {
+    std::string name_;
+    SpecialForm special_;
+public:
+    explicit Symbol(std::string name, SpecialForm special = SpecialForm::None);
+    Symbol(const Symbol&) = delete;
+    Symbol& operator=(const Symbol&) = delete;
+    [[nodiscard]] const std::string& name() const;
+    [[nodiscard]] SpecialForm special() const;
+};
+
+class SymbolTable {
+    static std::unordered_map<std::string_view, const Symbol*>& table();
+    static SpecialForm special_form(std::string_view name);
+public:
+    static const Symbol* intern(std::string_view name);
+};
+
+#endif //SYMBOL_H
@@ -1,70 +1,88 @@
 #include "types.h"
+#include "builtin.h"
 #include "env.h"
 #include "error.h"
 #include "evaluator.h"
+#include "vm.h"
+#include "mapped_file.h"
+#include "printer.h"
+#include <algorithm>
+#include <charconv>
 #include <iomanip>
-#include <regex>
+#include <iterator>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
 
+namespace {
+    constexpr std::size_t fnv_offset = 14695981039346656037ULL;
+    constexpr std::size_t fnv_prime = 1099511628211ULL;
 
-auto MalType::isKeyword(const std::string &token) -> bool {
-    return token[0] == ':';
-}
-
-auto MalType::isInt(const std::string& token) -> bool {
-    return std::regex_match(token, std::regex("^[-+]?[0-9]{1,19}$"));
-}
+    std::size_t hash_mix(std::size_t h) {
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
 
-auto MalType::isNil(const std::string& token) -> bool {
-    return token == "nil";
-}
+    std::size_t hash_combine(const std::size_t seed, const std::size_t h) {
+        return seed ^ (h + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+    }
 
-auto MalType::isBool(const std::string& token) -> bool {
-    return token == "true" || token == "false";
-}
+    std::size_t kind_seed(const MalKind kind) {
+        return hash_mix(static_cast<std::size_t>(kind) + 1);
+    }
 
-auto MalType::isString(const std::string &token) -> bool {
-    if (token.length() < 2) {
-        return false;
+    std::size_t hash_bytes(const std::string_view bytes, const std::size_t seed) {
+        std::size_t h = fnv_offset ^ seed;
+        for (const unsigned char c: bytes) {
+            h ^= c;
+            h *= fnv_prime;
+        }
+        return hash_mix(h);
     }
 
-    if (token[0] != '\"' || token[token.length() - 1] != '\"') {
-        return false;
+    // Cached hashes use 0 for "not computed yet", so a genuine 0 is nudged off it.
+    std::size_t cacheable(const std::size_t h) {
+        return h ? h : 1;
     }
+}
 
-    const std::string content = token.substr(1, token.length() - 2);
+std::size_t MalType::hash() const {
+    return kind_seed(this->kind_);
+}
 
-    for (std::size_t i = 0; i < content.length(); ++i) {
-        if (content[i] == '\\') {
-            if (i == content.length() - 1 ||
-                (content[i + 1] != 'n' && content[i + 1] != 't' && content[i + 1] != '\\' &&
-                 content[i + 1] != '\"' && content[i + 1] != 'r')) {
-                return false;
-            }
-            ++i;
-        }
-    }
+std::string MalType::to_string(const bool print_readably) const {
+    std::string out;
+    this->print(out, print_readably);
+    return out;
+}
 
-    return true;
+void MalStruct::print(std::string& out, const bool print_readably) const {
+    Printer::print(out, this, print_readably);
 }
 
-MalType::~MalType() {
-    delete this->meta_;
+void MalType::trace() const {
+    GC::mark(this->meta_);
 }
 
-auto MalNil::to_string(const bool) const -> std::string {
-    return this->printable ? "nil" : "";
+void MalNil::print(std::string& out, const bool) const {
+    if (this->printable) {
+        out += "nil";
+    }
 }
 
 MalNil *MalNil::clone() const {
-    return new MalNil(*this);
+    return MalNil::instance();
 }
 
 std::nullptr_t& MalNil::get_elem() {
     return this->val_;
 }
 
-MalRef::MalRef(MalType *val) : val_(val) {}
+MalRef::MalRef(MalType *val) : MalType(MalKind::Ref), val_(val) {}
 
 MalType *MalRef::get() const {
     return this->val_;
@@ -74,38 +92,89 @@ void MalRef::set(MalType *val) {
     this->val_ = val;
 }
 
+void MalRef::trace() const {
+    MalType::trace();
+    GC::mark(this->val_);
+}
+
 bool MalRef::equal(const MalType* other) const {
-    const auto other_ref = dynamic_cast<const MalRef*>(other);
+    const auto other_ref = dyn_cast<MalRef>(other);
     return other_ref && this->val_->equal(other_ref->val_);
 }
 
+std::size_t MalRef::hash() const {
+    return hash_combine(kind_seed(MalKind::Ref), this->val_->hash());
+}
+
 MalType* MalRef::clone() const {
     return new MalRef(this->val_->clone());
 }
 
-std::string MalRef::to_string(bool print_readably) const {
-    std::stringstream ss;
-    ss << "(atom ";
-    ss << this->val_->to_string(print_readably);
-    ss << ")";
-    return ss.str();
+void MalRef::print(std::string& out, const bool print_readably) const {
+    Printer::print(out, this, print_readably);
+}
+
+namespace {
+    // Canonical atoms, set up and rooted before main runs so no GCRootScope can drop them. Like every GCObject
+    // they live on the heap, never in static storage, so none is destroyed during static teardown. Interned
+    // keywords are created on the heap even when the reader asks for them inside its arena.
+    struct CanonicalAtoms final : GCRootSet {
+        MalNil* nil = new MalNil;
+        MalBool* yes = new MalBool(true);
+        MalBool* no = new MalBool(false);
+        MalList* empty_list = new MalList(std::vector<MalType*>{});
+        std::vector<MalInt*> small_ints;
+        std::unordered_map<std::string_view, MalKeyword*> keywords;
+
+        CanonicalAtoms() {
+            for (int64_t i = MalInt::small_min; i <= MalInt::small_max; ++i) {
+                this->small_ints.push_back(new MalInt(i));
+            }
+            GC::add_root(this);
+        }
+
+        void trace() const override {
+            GC::mark(this->nil);
+            GC::mark(this->yes);
+            GC::mark(this->no);
+            GC::mark(this->empty_list);
+            for (const auto n: this->small_ints) {
+                GC::mark(n);
+            }
+            for (const auto& [name, keyword]: this->keywords) {
+                GC::mark(keyword);
+            }
+        }
+    } canonical_atoms;
 }
 
-MalNil::MalNil(const bool printable, const std::nullptr_t val) : val_(val), printable(printable) {}
+MalNil::MalNil(const bool printable, const std::nullptr_t val)
+    : MalAtom(MalKind::Nil), val_(val), printable(printable) {}
+
+MalNil* MalNil::instance() {
+    return canonical_atoms.nil;
+}
 
 bool MalNil::equal(const MalType* type) const {
-    auto other_nil = dynamic_cast<const MalNil*>(type);
+    if (type == this) {
+        return true;
+    }
+    auto other_nil = dyn_cast<MalNil>(type);
     return other_nil;
 }
 
-MalBool::MalBool(const bool val) : val_(val) {}
+MalBool::MalBool(const bool val) : MalAtom(MalKind::Bool), val_(val) {}
+
+MalBool* MalBool::instance(const bool val) {
+    return val ? canonical_atoms.yes : canonical_atoms.no;
+}
 
-auto MalBool::to_string(const bool) const -> std::string {
-    return val_ ? "true" : "false";
+void MalBool::print(std::string& out, const bool) const {
+    out += this->val_ ? "true" : "false";
 }
 
 MalBool *MalBool::clone() const {
-    return new MalBool(*this);
+    return MalBool::instance(this->val_);
 }
 
 bool &MalBool::get_elem() {
@@ -113,18 +182,34 @@ bool &MalBool::get_elem() {
 }
 
 bool MalBool::equal(const MalType *type) const {
-    auto other_bool = dynamic_cast<const MalBool*>(type);
+    if (type == this) {
+        return true;
+    }
+    auto other_bool = dyn_cast<MalBool>(type);
     return other_bool && this->val_ == other_bool->val_;
 }
 
-MalInt::MalInt(const int64_t val) : val_(val) {}
+std::size_t MalBool::hash() const {
+    return hash_combine(kind_seed(MalKind::Bool), this->val_);
+}
+
+MalInt::MalInt(const int64_t val) : MalAtom(MalKind::Int), val_(val) {}
 
-auto MalInt::to_string(const bool) const -> std::string {
-    return std::to_string(this->val_);
+MalInt* MalInt::of(const int64_t val) {
+    if (val >= small_min && val <= small_max) {
+        return canonical_atoms.small_ints[static_cast<std::size_t>(val - small_min)];
+    }
+    return new MalInt(val);
+}
+
+void MalInt::print(std::string& out, const bool) const {
+    char digits[std::numeric_limits<int64_t>::digits10 + 2];
+    const auto end = std::to_chars(std::begin(digits), std::end(digits), this->val_).ptr;
+    out.append(digits, end);
 }
 
 MalInt *MalInt::clone() const {
-    return new MalInt(*this);
+    return MalInt::of(this->val_);
 }
 
 int64_t &MalInt::get_elem() {
@@ -132,36 +217,37 @@ int64_t &MalInt::get_elem() {
 }
 
 bool MalInt::equal(const MalType *type) const {
-    auto other_int = dynamic_cast<const MalInt*>(type);
+    auto other_int = dyn_cast<MalInt>(type);
     return other_int && this->val_ == other_int->val_;
 }
 
-MalString::MalString(const std::string& val) {
-    if (val.length() >= 2 && val.front() == '"' && val.back() == '"') {
-        val_ = val.substr(1, val.length() - 2);
-    } else {
-        val_ = val;
-    }
+std::size_t MalInt::hash() const {
+    return hash_mix(static_cast<std::size_t>(this->val_) ^ kind_seed(MalKind::Int));
 }
 
-auto MalString::to_string(const bool print_readably) const -> std::string {
-    if (!print_readably)
-        return this->val_;
+MalString::MalString(const std::string& val) : MalAtom(MalKind::String), val_(val) {}
+
+MalString::MalString(MappedFile* source, const std::string_view slice)
+    : MalAtom(MalKind::String), source_(source), slice_(slice) {}
+
+void MalString::print(std::string& out, const bool print_readably) const {
+    if (!print_readably) {
+        out += this->view();
+        return;
+    }
 
-    std::stringstream ss;
-    ss << "\"";
-    for (const auto& ch: this->val_) {
+    out += '"';
+    for (const auto& ch: this->view()) {
         switch (ch) {
-            case '\\': ss << "\\\\"; break;
-            case '\n': ss << "\\n"; break;
-            case '\t': ss << "\\t"; break;
-            case '\r': ss << "\\r"; break;
-            case '"': ss << "\\\""; break;
-            default: ss << ch;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            case '"': out += "\\\""; break;
+            default: out += ch;
         }
     }
-    ss << "\"";
-    return ss.str();
+    out += '"';
 }
 
 MalString *MalString::clone() const {
@@ -169,130 +255,364 @@ MalString *MalString::clone() const {
 }
 
 std::string &MalString::get_elem() {
+    if (this->source_) {
+        this->val_ = this->slice_;
+        this->source_ = nullptr;
+        this->slice_ = {};
+    }
     return this->val_;
 }
 
+std::string_view MalString::view() const {
+    return this->source_ ? this->slice_ : std::string_view(this->val_);
+}
+
+void MalString::trace() const {
+    MalType::trace();
+    GC::mark(this->source_);
+}
+
+// Short strings live inside the object, and a slice of a mapped file has no buffer of its own.
+std::size_t MalString::owned_bytes() const {
+    return this->val_.capacity() > std::string().capacity() ? this->val_.capacity() + 1 : 0;
+}
+
 bool MalString::equal(const MalType *type) const {
-    auto other_str = dynamic_cast<const MalString*>(type);
-    return other_str && this->val_ == other_str->val_;
+    auto other_str = dyn_cast<MalString>(type);
+    return other_str && this->view() == other_str->view();
 }
 
-MalSymbol::MalSymbol(std::string name) : name_(std::move(name)) {}
+std::size_t MalString::hash() const {
+    return hash_bytes(this->view(), kind_seed(MalKind::String));
+}
+
+MalSymbol::MalSymbol(const std::string_view name) : MalAtom(MalKind::Symbol), symbol_(SymbolTable::intern(name)) {}
+
+MalSymbol::MalSymbol(const Symbol* symbol) : MalAtom(MalKind::Symbol), symbol_(symbol) {}
 
-auto MalSymbol::to_string(const bool) const -> std::string {
-    return name_;
+void MalSymbol::print(std::string& out, const bool) const {
+    out += this->symbol_->name();
 }
 
 MalSymbol *MalSymbol::clone() const {
     return new MalSymbol(*this);
 }
 
-std::string MalSymbol::name() const {
-    return this->name_;
+const std::string& MalSymbol::name() const {
+    return this->symbol_->name();
+}
+
+const Symbol* MalSymbol::id() const {
+    return this->symbol_;
+}
+
+SpecialForm MalSymbol::special() const {
+    return this->symbol_->special();
 }
 
 bool MalSymbol::equal(const MalType *type) const {
-    auto other_symbol = dynamic_cast<const MalSymbol*>(type);
-    return other_symbol && this->name_ == other_symbol->name_;
+    auto other_symbol = dyn_cast<MalSymbol>(type);
+    return other_symbol && this->symbol_ == other_symbol->symbol_;
 }
 
-MalSequence::MalSequence(std::vector<MalType *> elements)
-    : elements_(std::move(elements)) {}
+std::size_t MalSymbol::hash() const {
+    return hash_bytes(this->symbol_->name(), kind_seed(MalKind::Symbol));
+}
 
-MalSequence::MalSequence(std::initializer_list<MalType *> elements)
-    : elements_(elements) {}
+MalLocal::MalLocal(MalSymbol* symbol, const std::size_t depth, const std::size_t slot, MalType* fallback)
+    : MalAtom(MalKind::Local), symbol_(symbol), depth_(depth), slot_(slot), fallback_(fallback) {}
 
-bool MalSequence::equal(const MalType* type) const
-{
-    auto other_sequence = dynamic_cast<const MalSequence*>(type);
-    if (!other_sequence){
-        return false;
+MalSymbol* MalLocal::symbol() const {
+    return this->symbol_;
+}
+
+std::size_t MalLocal::depth() const {
+    return this->depth_;
+}
+
+std::size_t MalLocal::slot() const {
+    return this->slot_;
+}
+
+MalType* MalLocal::fallback() const {
+    return this->fallback_;
+}
+
+void MalLocal::trace() const {
+    MalType::trace();
+    GC::mark(this->symbol_);
+    GC::mark(this->fallback_);
+}
+
+bool MalLocal::equal(const MalType *type) const {
+    auto other_local = dyn_cast<MalLocal>(type);
+    return other_local && this->depth_ == other_local->depth_ && this->slot_ == other_local->slot_ &&
+           this->symbol_->equal(other_local->symbol_);
+}
+
+std::size_t MalLocal::hash() const {
+    return hash_combine(hash_combine(this->symbol_->hash(), this->depth_), this->slot_);
+}
+
+MalLocal *MalLocal::clone() const {
+    return new MalLocal(*this);
+}
+
+void MalLocal::print(std::string& out, const bool print_readably) const {
+    this->symbol_->print(out, print_readably);
+}
+
+MalSequence::MalSequence(const MalKind kind) : MalStruct(kind) {}
+
+MalSequence::const_iterator::const_iterator(const MalSequence* sequence, const std::size_t index)
+    : sequence_(sequence), index_(index) {
+    if (index < sequence->size()) {
+        this->chunk_ = sequence->chunk(index);
     }
-    std::size_t i;
-    for (i = 0; i < this->elements_.size() && i < other_sequence->elements_.size(); ++i) {
-        if (!this->elements_[i]->equal(other_sequence->elements_[i])){
-            return false;
-        }
+}
+
+MalSequence::const_iterator& MalSequence::const_iterator::operator++() {
+    ++this->index_;
+    this->chunk_ = this->chunk_.subspan(1);
+    if (this->chunk_.empty() && this->index_ < this->sequence_->size()) {
+        this->chunk_ = this->sequence_->chunk(this->index_);
     }
-    return i == this->elements_.size() && i == other_sequence->elements_.size();
+    return *this;
 }
 
-std::vector<MalType *> &MalSequence::get_elem() {
-    return this->elements_;
+MalSequence::const_iterator MalSequence::const_iterator::operator++(int) {
+    const auto previous = *this;
+    ++*this;
+    return previous;
 }
 
-std::string MalSequence::to_string(const bool print_readably) const {
-    std::stringstream ss;
-    bool first = true;
-    for (const auto& element : this->elements_) {
-        if (!first) {
-            ss << " ";
-        }
-        ss << element->to_string(print_readably);
-        first = false;
+bool MalSequence::empty() const {
+    return this->size() == 0;
+}
+
+MalSequence::const_iterator MalSequence::begin() const {
+    return {this, 0};
+}
+
+MalSequence::const_iterator MalSequence::end() const {
+    return {this, this->size()};
+}
+
+std::vector<MalType*> MalSequence::to_vector() const {
+    std::vector<MalType*> elements;
+    elements.reserve(this->size());
+    elements.insert(elements.end(), this->begin(), this->end());
+    return elements;
+}
+
+bool MalSequence::equal(const MalType* type) const
+{
+    auto other_sequence = dyn_cast<MalSequence>(type);
+    if (!other_sequence || this->size() != other_sequence->size()){
+        return false;
+    }
+    if (this->hash_ && other_sequence->hash_ && this->hash_ != other_sequence->hash_){
+        return false;
     }
-    return ss.str();
+    return std::equal(this->begin(), this->end(), other_sequence->begin(),
+                      [](const MalType* lhs, const MalType* rhs) { return lhs->equal(rhs); });
 }
 
-MalSequence::~MalSequence() {
-    for (const auto& e: this->elements_) {
-        delete e;
+std::size_t MalSequence::hash() const {
+    if (!this->hash_) {
+        // Lists and vectors with equal elements compare equal, so both start from the list seed.
+        std::size_t h = kind_seed(MalKind::List);
+        for (const auto e: *this) {
+            h = hash_combine(h, e->hash());
+        }
+        this->hash_ = cacheable(h);
     }
+    return this->hash_;
 }
 
 std::vector<MalType *> MalSequence::elem_clone() const {
     std::vector<MalType*> copied;
-    for (auto* e : elements_) {
+    for (auto* e : *this) {
         copied.push_back(e->clone());
     }
     return copied;
 }
 
-MalList::MalList(std::vector<MalType*> elements)
-        : MalSequence(std::move(elements)) {}
+void ListChunk::trace() const {
+    for (const auto value: this->values) {
+        GC::mark(value);
+    }
+}
+
+std::size_t ListChunk::owned_bytes() const {
+    return this->values.capacity() * sizeof(MalType*);
+}
+
+MalList::MalList(std::vector<MalType*> elements) : MalList(std::move(elements), nullptr) {}
+
+MalList::MalList(std::initializer_list<MalType *> elements) : MalList(std::vector<MalType*>(elements), nullptr) {}
+
+MalList::MalList(std::vector<MalType*> elements, MalList* rest)
+    : MalSequence(MalKind::List), rest_(rest && rest->size_ ? rest : nullptr),
+      size_(elements.size() + (rest ? rest->size_ : 0)) {
+    if (!elements.empty()) {
+        this->chunk_ = new ListChunk;
+        this->chunk_->values = std::move(elements);
+    } else if (this->rest_) {
+        this->chunk_ = this->rest_->chunk_;
+        this->begin_ = this->rest_->begin_;
+        this->rest_ = this->rest_->rest_;
+    }
+}
+
+MalList::MalList(ListChunk* chunk, const std::size_t begin, MalList* rest)
+    : MalSequence(MalKind::List), chunk_(chunk), begin_(begin), rest_(rest),
+      size_(chunk->values.size() - begin + (rest ? rest->size_ : 0)) {}
+
+MalList* MalList::cons(MalType* head, MalList* tail) {
+    // A short head chunk is copied with the new element in front; a full one becomes the shared tail.
+    if (tail->size_ && tail->own_size() < chunk_size) {
+        const auto chunk = new ListChunk;
+        chunk->values.reserve(tail->own_size() + 1);
+        chunk->values.push_back(head);
+        const auto own = tail->chunk_->values.begin() + static_cast<std::ptrdiff_t>(tail->begin_);
+        chunk->values.insert(chunk->values.end(), own, tail->chunk_->values.end());
+        return new MalList(chunk, 0, tail->rest_);
+    }
+    return new MalList(std::vector<MalType*>{head}, tail);
+}
+
+MalList* MalList::empty_instance() {
+    return canonical_atoms.empty_list;
+}
 
-auto MalList::to_string(const bool print_readably) const -> std::string {
-    std::stringstream ss;
-    ss << "(";
-    ss << MalSequence::to_string(print_readably);
-    ss << ")";
-    return ss.str();
+MalList* MalList::rest() const {
+    if (this->size_ <= 1) {
+        return empty_instance();
+    }
+    if (this->own_size() == 1) {
+        return this->rest_;
+    }
+    return new MalList(this->chunk_, this->begin_ + 1, this->rest_);
 }
 
-MalList::MalList(std::initializer_list<MalType *> elements)
-    : MalSequence(elements) {}
+std::size_t MalList::own_size() const {
+    return this->chunk_ ? this->chunk_->values.size() - this->begin_ : 0;
+}
+
+std::span<MalType* const> MalList::get_elem() const {
+    if (this->rest_) {
+        const auto chunk = new ListChunk;
+        chunk->values = this->to_vector();
+        this->chunk_ = chunk;
+        this->begin_ = 0;
+        this->rest_ = nullptr;
+        this->cursor_ = nullptr;
+    }
+    if (!this->chunk_) {
+        return {};
+    }
+    return std::span<MalType* const>(this->chunk_->values).subspan(this->begin_);
+}
+
+std::size_t MalList::size() const {
+    return this->size_;
+}
+
+MalType* MalList::nth(const std::size_t index) const {
+    return this->chunk(index).front();
+}
+
+std::span<MalType* const> MalList::chunk(std::size_t index) const {
+    const MalList* link = this;
+    if (this->cursor_ && this->cursor_index_ <= index) {
+        link = this->cursor_;
+        index -= this->cursor_index_;
+    } else {
+        this->cursor_index_ = 0;
+    }
+    while (index >= link->own_size()) {
+        index -= link->own_size();
+        this->cursor_index_ += link->own_size();
+        link = link->rest_;
+    }
+    this->cursor_ = link;
+    return std::span<MalType* const>(link->chunk_->values).subspan(link->begin_ + index);
+}
+
+void MalList::trace() const {
+    MalType::trace();
+    GC::mark(this->chunk_);
+    GC::mark(this->rest_);
+}
 
 MalList *MalList::clone() const {
     return new MalList(this->elem_clone());
 }
 
-MalVector::MalVector(std::vector<MalType *> elements)
-    : MalSequence(std::move(elements)) {}
+MalVector::MalVector(const std::span<MalType* const> elements)
+    : MalSequence(MalKind::Vector), elements_(elements) {}
+
+MalVector::MalVector(std::initializer_list<MalType *> elements)
+    : MalVector(std::span<MalType* const>(elements.begin(), elements.size())) {}
+
+MalVector::MalVector(const PVector& elements) : MalSequence(MalKind::Vector), elements_(elements) {}
+
+const PVector& MalVector::get_elem() const {
+    return this->elements_;
+}
+
+std::size_t MalVector::size() const {
+    return this->elements_.size();
+}
+
+MalType* MalVector::nth(const std::size_t index) const {
+    return this->elements_.nth(index);
+}
+
+std::span<MalType* const> MalVector::chunk(const std::size_t index) const {
+    return this->elements_.chunk(index);
+}
 
-auto MalVector::to_string(const bool print_readably) const -> std::string {
-    std::stringstream ss;
-    ss << "[";
-    ss << MalSequence::to_string(print_readably);
-    ss << "]";
-    return ss.str();
+MalVector* MalVector::conj(MalType* value) const {
+    return new MalVector(this->elements_.conj(value));
+}
+
+MalVector* MalVector::assoc(const std::size_t index, MalType* value) const {
+    return new MalVector(this->elements_.assoc(index, value));
+}
+
+void MalVector::trace() const {
+    MalType::trace();
+    this->elements_.trace();
 }
 
 MalVector *MalVector::clone() const {
     return new MalVector(this->elem_clone());
 }
 
-MalVector::MalVector(std::initializer_list<MalType *> elements)
-    : MalSequence(elements) {}
-
 MalKeyword::MalKeyword(std::string name)
-        : name_(std::move(name)) {}
+        : MalAtom(MalKind::Keyword), name_(std::move(name)),
+          hash_(hash_bytes(this->name_, kind_seed(MalKind::Keyword))) {}
 
-auto MalKeyword::to_string(const bool) const -> std::string {
-    return ":" + this->name_;
+MalKeyword* MalKeyword::intern(const std::string_view name) {
+    auto& keywords = canonical_atoms.keywords;
+    if (const auto it = keywords.find(name); it != keywords.end()) {
+        return it->second;
+    }
+    GCHeapScope heap;
+    const auto keyword = new MalKeyword(std::string(name));
+    keywords.emplace(keyword->name_, keyword);
+    return keyword;
+}
+
+void MalKeyword::print(std::string& out, const bool) const {
+    out += ':';
+    out += this->name_;
 }
 
 MalKeyword *MalKeyword::clone() const {
-    return new MalKeyword(*this);
+    return const_cast<MalKeyword*>(this);
 }
 
 std::string MalKeyword::name() const {
@@ -300,61 +620,50 @@ std::string MalKeyword::name() const {
 }
 
 bool MalKeyword::equal(const MalType *type) const {
-    auto other_keyword = dynamic_cast<const MalKeyword*>(type);
-    return other_keyword && this->name_ == other_keyword->name_;
+    return type == this;
 }
 
+std::size_t MalKeyword::hash() const {
+    return this->hash_;
+}
 
-MalMap::MalMap(const std::set<MalPair*>& elements)
-        : elements_(elements) {}
 
-auto MalMap::to_string(const bool print_readably) const -> std::string {
-    std::stringstream ss;
-    ss << "{";
-    bool first = true;
-    for (const auto& e : elements_) {
-        if (!first) {
-            ss << " ";
-        }
-        ss << e->to_string(print_readably);
-        first = false;
-    }
-    ss << "}";
-    return ss.str();
-}
+MalMap::MalMap() : MalStruct(MalKind::Map) {}
 
-MalMap::~MalMap() {
-    for (const auto& e: this->elements_) {
-        delete e;
-    }
+MalMap::MalMap(const Hamt& elements)
+        : MalStruct(MalKind::Map), elements_(elements) {}
+
+void MalMap::trace() const {
+    MalType::trace();
+    this->elements_.trace();
 }
 
 MalMap* MalMap::clone() const {
-    std::set<MalPair*> copied;
-    for (const auto& e : elements_) {
-        copied.insert(e);
-    }
-    return new MalMap(copied);
+    return new MalMap(this->elements_);
 }
 
-std::set<MalPair*>& MalMap::get_elem() {
+const Hamt& MalMap::get_elem() const {
     return this->elements_;
 }
 
+std::size_t MalMap::size() const {
+    return this->elements_.size();
+}
+
 bool MalMap::equal(const MalType *type) const {
-    auto other_map = dynamic_cast<const MalMap*>(type);
+    auto other_map = dyn_cast<MalMap>(type);
     if (!other_map) return false;
 
     if (this->elements_.size() != other_map->elements_.size()) {
         return false;
     }
+    if (this->hash_ && other_map->hash_ && this->hash_ != other_map->hash_) {
+        return false;
+    }
 
-    for (const auto& pair : this->elements_) {
-        MalType* key = pair->key();
-        MalType* value = pair->value();
-
-        MalType* other_val = other_map->get(key);
-        if (!other_val || !value->equal(other_val)) {
+    for (const auto pair : this->elements_) {
+        MalType* other_val = other_map->get(pair->key());
+        if (!other_val || !pair->value()->equal(other_val)) {
             return false;
         }
     }
@@ -362,33 +671,45 @@ bool MalMap::equal(const MalType *type) const {
     return true;
 }
 
-MalType *MalMap::get(MalType *key) const {
-    for (const auto& pair : elements_) {
-        if (pair->key()->equal(key)) {
-            return pair->value();
+std::size_t MalMap::hash() const {
+    if (!this->hash_) {
+        // Map equality ignores entry order, so entry hashes are summed rather than chained.
+        std::size_t h = kind_seed(MalKind::Map);
+        for (const auto entry: this->elements_) {
+            h += hash_combine(entry->key()->hash(), entry->value()->hash());
         }
+        this->hash_ = cacheable(h);
     }
-    return nullptr;
+    return this->hash_;
+}
+
+MalType *MalMap::get(MalType *key) const {
+    const auto pair = this->elements_.find(key);
+    return pair ? pair->value() : nullptr;
 }
 
 void MalMap::put(MalType *key, MalType *value) {
-    for (const auto& pair : this->elements_) {
-        if (pair->key()->equal(key)) {
-            pair->setValue(value);
-            return;
-        }
-    }
-    this->elements_.insert(new MalPair(key, value));
+    this->elements_ = this->elements_.assoc(new MalPair(key, value));
+    this->hash_ = 0;
 }
 
-MalMetaData::MalMetaData(MalMap *map) : data_(map) {}
+MalMap* MalMap::assoc(MalType *key, MalType *value) const {
+    return new MalMap(this->elements_.assoc(new MalPair(key, value)));
+}
 
-MalMetaData::~MalMetaData() {
-    delete this->data_;
+MalMap* MalMap::dissoc(MalType *key) const {
+    return new MalMap(this->elements_.dissoc(key));
 }
 
-std::string MalMetaData::to_string(const bool) const {
-    return std::string(); // todo
+MalMetaData::MalMetaData(MalMap *map) : MalType(MalKind::MetaData), data_(map) {}
+
+void MalMetaData::trace() const {
+    MalType::trace();
+    GC::mark(this->data_);
+}
+
+void MalMetaData::print(std::string&, const bool) const {
+    // todo
 }
 
 MalMap *MalMetaData::get_map() {
@@ -409,102 +730,73 @@ MalMetaData *MalMetaData::clone() const {
 }
 
 bool MalMetaData::equal(const MalType *type) const {
-    auto other_metadata = dynamic_cast<const MalMetaData*>(type);
+    auto other_metadata = dyn_cast<MalMetaData>(type);
     return other_metadata && this->data_->equal(other_metadata->data_);
 }
 
-MalSyntaxQuote::MalSyntaxQuote(MalType *expr) : expr_(expr) {}
+MalSyntaxQuote::MalSyntaxQuote(const MalKind kind, MalType *expr) : MalStruct(kind), expr_(expr) {}
 
-MalSyntaxQuote::~MalSyntaxQuote() {
-    delete this->expr_;
+void MalSyntaxQuote::trace() const {
+    MalType::trace();
+    GC::mark(this->expr_);
 }
 
 MalType* MalSyntaxQuote::get() const {
     return this->expr_;
 }
 
-MalQuote::MalQuote(MalType *expr) : MalSyntaxQuote(expr) {}
-
-std::string MalQuote::to_string(const bool print_readably) const {
-    std::stringstream ss;
-    ss << "(quote " << this->expr_->to_string(print_readably) << ")";
-    return ss.str();
-}
+MalQuote::MalQuote(MalType *expr) : MalSyntaxQuote(MalKind::Quote, expr) {}
 
 MalQuote *MalQuote::clone() const {
     return new MalQuote(*this);
 }
 
 bool MalQuote::equal(const MalType *type) const {
-    return dynamic_cast<const MalQuote*>(type);
+    return isa<MalQuote>(type);
 }
 
-MalQuasiQuote::MalQuasiQuote(MalType *expr) : MalSyntaxQuote(expr) {}
-
-std::string MalQuasiQuote::to_string(const bool print_readably) const {
-    std::stringstream ss;
-    ss << "(quasiquote " << this->expr_->to_string(print_readably) << ")";
-    return ss.str();
-}
+MalQuasiQuote::MalQuasiQuote(MalType *expr) : MalSyntaxQuote(MalKind::QuasiQuote, expr) {}
 
 MalQuasiQuote *MalQuasiQuote::clone() const {
     return new MalQuasiQuote(*this);
 }
 
 bool MalQuasiQuote::equal(const MalType *type) const {
-    return dynamic_cast<const MalQuasiQuote*>(type);
+    return isa<MalQuasiQuote>(type);
 }
 
-MalUnQuote::MalUnQuote(MalType *expr) : MalSyntaxQuote(expr) {}
-
-std::string MalUnQuote::to_string(const bool print_readably) const {
-    std::stringstream ss;
-    ss << "(unquote " << this->expr_->to_string(print_readably) << ")";
-    return ss.str();
-}
+MalUnQuote::MalUnQuote(MalType *expr) : MalSyntaxQuote(MalKind::UnQuote, expr) {}
 
 MalUnQuote *MalUnQuote::clone() const {
     return new MalUnQuote(*this);
 }
 
 bool MalUnQuote::equal(const MalType *type) const {
-    return dynamic_cast<const MalUnQuote*>(type);
+    return isa<MalUnQuote>(type);
 }
 
-MalUnQuoteSplicing::MalUnQuoteSplicing(MalType *expr) : MalSyntaxQuote(expr) {}
-
-std::string MalUnQuoteSplicing::to_string(const bool print_readably) const {
-    std::stringstream ss;
-    ss << "(splice-unquote " << this->expr_->to_string(print_readably) << ")";
-    return ss.str();
-}
+MalUnQuoteSplicing::MalUnQuoteSplicing(MalType *expr) : MalSyntaxQuote(MalKind::UnQuoteSplicing, expr) {}
 
 MalUnQuoteSplicing *MalUnQuoteSplicing::clone() const {
     return new MalUnQuoteSplicing(*this);
 }
 
 bool MalUnQuoteSplicing::equal(const MalType *type) const {
-    return dynamic_cast<const MalUnQuoteSplicing*>(type);
+    return isa<MalUnQuoteSplicing>(type);
 }
 
-MalDeref::MalDeref(MalType *expr) : MalSyntaxQuote(expr) {}
-
-std::string MalDeref::to_string(const bool print_readably) const {
-    std::stringstream ss;
-    ss << "(deref " << this->expr_->to_string(print_readably) << ")";
-    return ss.str();
-}
+MalDeref::MalDeref(MalType *expr) : MalSyntaxQuote(MalKind::Deref, expr) {}
 
 MalDeref *MalDeref::clone() const {
     return new MalDeref(*this);
 }
 
 bool MalDeref::equal(const MalType *type) const {
-    return dynamic_cast<const MalDeref*>(type);
+    return isa<MalDeref>(type);
 }
 
 MalMetaSymbol::MalMetaSymbol(MalType *meta, MalType *value)
-    : MalSyntaxQuote(nullptr), meta_(meta), value_(value) {}
+    : MalSyntaxQuote(MalKind::MetaSymbol, nullptr), meta_(meta), value_(value) {}
 
 MalType *MalMetaSymbol::get_meta() const {
     return this->meta_;
@@ -514,16 +806,10 @@ MalType *MalMetaSymbol::get_value() const {
     return this->value_;
 }
 
-std::string MalMetaSymbol::to_string(const bool print_readably) const {
-    std::stringstream ss;
-    ss << "(with-meta " << this->value_->to_string(print_readably);
-    ss << " " << this->meta_->to_string(print_readably) << ")";
-    return ss.str();
-}
-
-MalMetaSymbol::~MalMetaSymbol() {
-    delete this->meta_;
-    delete this->value_;
+void MalMetaSymbol::trace() const {
+    MalSyntaxQuote::trace();
+    GC::mark(this->meta_);
+    GC::mark(this->value_);
 }
 
 MalMetaSymbol *MalMetaSymbol::clone() const {
@@ -531,37 +817,81 @@ MalMetaSymbol *MalMetaSymbol::clone() const {
 }
 
 bool MalMetaSymbol::equal(const MalType *type) const {
-    const auto other_meta_symbol = dynamic_cast<const MalMetaSymbol*>(type);
+    const auto other_meta_symbol = dyn_cast<MalMetaSymbol>(type);
     return other_meta_symbol &&
            this->meta_->equal(other_meta_symbol->meta_) &&
            this->value_->equal(other_meta_symbol->value_);
 }
 
-MalFunction::MalFunction(std::function<mal_func_type> fn)
-    : func_(std::move(fn)), is_builtin(true), args_list(nullptr), body_(nullptr), env_(nullptr) {}
+std::size_t MalMetaSymbol::hash() const {
+    return hash_combine(hash_combine(kind_seed(MalKind::MetaSymbol), this->meta_->hash()), this->value_->hash());
+}
 
-MalFunction::MalFunction(MalSequence *args, MalType *body, Env* env)
-    : is_builtin(false), args_list(args), body_(body), env_(env) {}
+MalFunction::MalFunction(const Builtin* builtin)
+    : MalType(MalKind::Function), builtin_(builtin), args_list(nullptr), body_(nullptr), env_(nullptr), chunk_(nullptr) {}
 
-MalType *MalFunction::operator()(mal_func_args_list_type& params) const {
-    if (this->is_builtin){
-        return this->func_(params);
-    }
-    const auto& args_list_elems = this->args_list->get_elem();
-    const auto size = args_list_elems.size();
-    std::vector<std::string> args_names(size);
-    for (std::size_t i = 0; i < size; ++i) {
-        const auto sym = dynamic_cast<MalSymbol*>(args_list_elems[i]);
+ParamBinding ParamBinding::compile(const MalSequence* params) {
+    static const Symbol* const rest_marker = SymbolTable::intern("&");
+    ParamBinding binding;
+    for (const auto param: *params) {
+        const auto sym = dyn_cast<MalSymbol>(param);
         if (!sym) {
             throw typeError("fn* parameters must be symbols");
         }
-        args_names[i] = sym->name();
+        if (sym->id() == rest_marker) {
+            if (binding.variadic || binding.fixed_arity + 2 != params->size()) {
+                throw syntaxError("malfunctioning & param usage");
+            }
+            binding.variadic = true;
+        } else if (!binding.variadic) {
+            ++binding.fixed_arity;
+        }
+    }
+    return binding;
+}
+
+void ParamBinding::check_arity(const std::size_t count) const {
+    if (this->variadic) {
+        if (count < this->fixed_arity) {
+            throw argInvalidError("too few arguments");
+        }
+    } else if (count != this->fixed_arity) {
+        throw argInvalidError("expected " + std::to_string(this->fixed_arity) +
+                              " arg(s), given " + std::to_string(count) + " arg(s)");
     }
-    const auto local_env = new Env(this->env_, args_names, params);
-    return Evaluator::eval(this->body_, local_env);
 }
 
-MalType *MalFunction::apply(mal_func_args_list_type& args) const {
+MalFunction::MalFunction(MalSequence *args, const ParamBinding& binding, MalType *body, Env* env)
+    : MalType(MalKind::Function), builtin_(nullptr), args_list(args), binding_(binding), body_(body), env_(env), chunk_(nullptr) {}
+
+MalFunction* MalFunction::closure(MalSequence* args, MalType* body, Env* env) {
+    const ParamBinding binding = ParamBinding::compile(args);
+    return new MalFunction(args, binding, body, env);
+}
+
+const ParamBinding& MalFunction::binding() const {
+    return this->binding_;
+}
+
+Env* MalFunction::make_env(const mal_func_args_list_type params) const {
+    // Checked before the frame is allocated, so a bad call throws without a half-built Env.
+    this->binding_.check_arity(params.size());
+    return new Env(this->env_, this->binding_, params);
+}
+
+Env* MalFunction::make_env(const std::span<const Value> params) const {
+    this->binding_.check_arity(params.size());
+    return new Env(this->env_, this->binding_, params);
+}
+
+MalType *MalFunction::operator()(const mal_func_args_list_type params) const {
+    if (this->builtin_){
+        return this->builtin_->call(params);
+    }
+    return Evaluator::exec(this->body_, this->make_env(params));
+}
+
+MalType *MalFunction::apply(const mal_func_args_list_type args) const {
     return (*this)(args);
 }
 
@@ -569,8 +899,8 @@ MalFunction *MalFunction::clone() const {
     return new MalFunction(*this);
 }
 
-std::string MalFunction::to_string(const bool) const {
-    return "#<function>";
+void MalFunction::print(std::string& out, const bool) const {
+    out += "#<function>";
 }
 
 bool MalFunction::equal(const MalType*) const {
@@ -590,11 +920,31 @@ Env* MalFunction::get_env() const {
 }
 
 bool MalFunction::is_builtin_func() const {
-    return this->is_builtin;
+    return this->builtin_ != nullptr;
+}
+
+Primitive MalFunction::primitive() const {
+    return this->builtin_ ? this->builtin_->primitive : Primitive::None;
+}
+
+Chunk* MalFunction::get_chunk() const {
+    return this->chunk_;
+}
+
+void MalFunction::set_chunk(Chunk* chunk) {
+    this->chunk_ = chunk;
+}
+
+void MalFunction::trace() const {
+    MalType::trace();
+    GC::mark(this->args_list);
+    GC::mark(this->body_);
+    GC::mark(this->env_);
+    GC::mark(this->chunk_);
 }
 
 MalPair::MalPair(MalType *key, MalType *value)
-    : data_(key, value) {}
+    : MalStruct(MalKind::Pair), data_(key, value) {}
 
 MalType *MalPair::key() const {
     return this->data_.first;
@@ -605,26 +955,26 @@ MalType *MalPair::value() const {
 }
 
 bool MalPair::equal(const MalType *other) const {
-    const auto other_pair = dynamic_cast<const MalPair*>(other);
+    const auto other_pair = dyn_cast<MalPair>(other);
     return other_pair &&
            this->key()->equal(other_pair->key()) &&
            this->value()->equal(other_pair->value());
 }
 
-MalPair* MalPair::clone() const {
-    return new MalPair(this->key()->clone(), this->value()->clone());
-}
-
-std::string MalPair::to_string(const bool print_readably) const {
-    return this->key()->to_string(print_readably) + " " + this->value()->to_string(print_readably);
+std::size_t MalPair::hash() const {
+    return hash_combine(hash_combine(kind_seed(MalKind::Pair), this->key()->hash()), this->value()->hash());
 }
 
-MalPair::~MalPair() {
-    delete this->data_.first;
-    delete this->data_.second;
+MalPair* MalPair::clone() const {
+    return new MalPair(this->key()->clone(), this->value()->clone());
 }
 
 void MalPair::setValue(MalType* val) {
-    delete this->data_.second;
     this->data_.second = val;
 }
+
+void MalPair::trace() const {
+    MalType::trace();
+    GC::mark(this->data_.first);
+    GC::mark(this->data_.second);
+}
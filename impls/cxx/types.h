@@ -1,51 +1,113 @@
 #ifndef TYPES_H
 #define TYPES_H
-#include <set>
+#include <cassert>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 #include <cstdint>
 #include <functional>
+#include <iterator>
+#include <span>
+#include "gc.h"
+#include "hamt.h"
+#include "pvector.h"
+
+// Integers in this range share one preallocated MalInt each; override with -D in CXXFLAGS.
+#ifndef MAL_SMALL_INT_MIN
+#define MAL_SMALL_INT_MIN (-128)
+#endif
+#ifndef MAL_SMALL_INT_MAX
+#define MAL_SMALL_INT_MAX 1023
+#endif
+#include "symbol.h"
+#include "value.h"
 
 
 class Env;
+class Chunk;
+struct Builtin;
 class MalMetaData;
+class MappedFile;
+
+enum class MalKind : uint8_t {
+    Nil,
+    Bool,
+    Int,
+    String,
+    Symbol,
+    Local,
+    Keyword,
+    List,
+    Vector,
+    Pair,
+    Map,
+    Quote,
+    QuasiQuote,
+    UnQuote,
+    UnQuoteSplicing,
+    Deref,
+    MetaSymbol,
+    Ref,
+    MetaData,
+    Function,
+};
 
-class MalType {
+class MalType : public GCObject {
+        const MalKind kind_;
     protected:
         MalMetaData* meta_ = nullptr;
+
+        explicit MalType(const MalKind kind) : kind_(kind) {}
     public:
-        static bool isKeyword(const std::string& token);
-        static bool isInt(const std::string& token);
-        static bool isNil(const std::string& token);
-        static bool isBool(const std::string& token);
-        static bool isString(const std::string& token);
+        [[nodiscard]] MalKind kind() const { return this->kind_; }
+        static bool classof(const MalType*) { return true; }
 
-        virtual ~MalType();
+        ~MalType() override = default;
+        void trace() const override;
         virtual bool equal(const MalType*) const = 0;
+        // Structural hash: values that compare equal() hash alike. Kinds compared by tag alone keep this default.
+        [[nodiscard]] virtual std::size_t hash() const;
         [[nodiscard]] virtual MalType* clone() const = 0;
-        [[nodiscard]] virtual std::string to_string(bool print_readably) const = 0;
+        // Appends the printed form to out; structures hand their traversal to Printer::print.
+        virtual void print(std::string& out, bool print_readably) const = 0;
+        [[nodiscard]] std::string to_string(bool print_readably) const;
 };
 
 class MalRef final : public MalType {
     MalType* val_;
 public:
+    static bool classof(const MalType* type) { return type->kind() == MalKind::Ref; }
     explicit MalRef(MalType* val);
     [[nodiscard]] MalType* get() const;
     void set(MalType* val);
+    void trace() const override;
     bool equal(const MalType* other) const override;
+    [[nodiscard]] std::size_t hash() const override;
     [[nodiscard]] MalType* clone() const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
+    void print(std::string& out, bool print_readably) const override;
 };
 
 class MalAtom : public MalType {
+    protected:
+        explicit MalAtom(const MalKind kind) : MalType(kind) {}
     public:
+        static bool classof(const MalType* type) {
+            return type->kind() >= MalKind::Nil && type->kind() <= MalKind::Keyword;
+        }
         [[nodiscard]] MalAtom* clone() const override = 0;
         ~MalAtom() override = default;
 };
 
 class MalStruct : public MalType {
+    protected:
+        explicit MalStruct(const MalKind kind) : MalType(kind) {}
     public:
+        static bool classof(const MalType* type) {
+            return type->kind() >= MalKind::List && type->kind() <= MalKind::MetaSymbol;
+        }
         [[nodiscard]] MalStruct* clone() const override = 0;
+        void print(std::string& out, bool print_readably) const override;
         ~MalStruct() override = default;
 };
 
@@ -53,134 +115,272 @@ class MalNil final : public MalAtom {
         std::nullptr_t val_;
         bool printable;
     public:
+        static bool classof(const MalType* type) { return type->kind() == MalKind::Nil; }
         explicit MalNil(bool printable = true, std::nullptr_t val = std::nullptr_t{});
+        // The only nil: builtins, special forms, the reader and clone() all return it. It is never collected.
+        static MalNil* instance();
         [[nodiscard]] std::nullptr_t& get_elem();
 
         bool equal(const MalType *type) const override;
         [[nodiscard]] MalNil* clone() const override;
-        [[nodiscard]] std::string to_string(bool print_readably) const override;
+        void print(std::string& out, bool print_readably) const override;
 };
 
 class MalBool final : public MalAtom {
         bool val_;
     public:
+        static bool classof(const MalType* type) { return type->kind() == MalKind::Bool; }
         explicit MalBool(bool val);
+        // The only true or false; like MalNil::instance(), clone() returns it and it is never collected.
+        static MalBool* instance(bool val);
         [[nodiscard]] bool& get_elem();
 
         bool equal(const MalType *type) const override;
+        [[nodiscard]] std::size_t hash() const override;
         [[nodiscard]] MalBool* clone() const override;
-        [[nodiscard]] std::string to_string(bool print_readably) const override;
+        void print(std::string& out, bool print_readably) const override;
 };
 
 class MalInt final : public MalAtom {
         int64_t val_;
     public:
+        static bool classof(const MalType* type) { return type->kind() == MalKind::Int; }
+        constexpr static int64_t small_min = MAL_SMALL_INT_MIN;
+        constexpr static int64_t small_max = MAL_SMALL_INT_MAX;
+
         explicit MalInt(int64_t val);
+        // The cached instance for a small value, otherwise a new one.
+        static MalInt* of(int64_t val);
         int64_t& get_elem();
         bool equal(const MalType *type) const override;
+        [[nodiscard]] std::size_t hash() const override;
         [[nodiscard]] MalInt* clone() const override;
-        [[nodiscard]] std::string to_string(bool print_readably) const override;
+        void print(std::string& out, bool print_readably) const override;
 };
 
 class MalString final : public MalAtom {
         std::string val_;
+        // A slice of a mapped file is read in place until get_elem() needs a string of its own.
+        MappedFile* source_ = nullptr;
+        std::string_view slice_;
     public:
+        static bool classof(const MalType* type) { return type->kind() == MalKind::String; }
         explicit MalString(const std::string&  val);
+        MalString(MappedFile* source, std::string_view slice);
         std::string& get_elem();
+        [[nodiscard]] std::string_view view() const;
+        void trace() const override;
+        [[nodiscard]] std::size_t owned_bytes() const override;
         bool equal(const MalType *type) const override;
+        [[nodiscard]] std::size_t hash() const override;
         [[nodiscard]] MalString* clone() const override;
-        [[nodiscard]] std::string to_string(bool print_readably) const override;
+        void print(std::string& out, bool print_readably) const override;
 };
 
 class MalSymbol final : public MalAtom {
-        std::string name_;
+        const Symbol* symbol_;
     public:
-        explicit MalSymbol(std::string name);
-        [[nodiscard]] std::string name() const;
+        static bool classof(const MalType* type) { return type->kind() == MalKind::Symbol; }
+        explicit MalSymbol(std::string_view name);
+        explicit MalSymbol(const Symbol* symbol);
+        [[nodiscard]] const std::string& name() const;
+        [[nodiscard]] const Symbol* id() const;
+        [[nodiscard]] SpecialForm special() const;
         bool equal(const MalType *type) const override;
+        [[nodiscard]] std::size_t hash() const override;
         [[nodiscard]] MalSymbol* clone() const override;
-        [[nodiscard]] std::string to_string(bool print_readably) const override;
+        void print(std::string& out, bool print_readably) const override;
+};
+
+class MalLocal final : public MalAtom {
+        MalSymbol* symbol_;
+        std::size_t depth_;
+        std::size_t slot_;
+        MalType* fallback_;
+    public:
+        static bool classof(const MalType* type) { return type->kind() == MalKind::Local; }
+        MalLocal(MalSymbol* symbol, std::size_t depth, std::size_t slot, MalType* fallback = nullptr);
+        [[nodiscard]] MalSymbol* symbol() const;
+        [[nodiscard]] std::size_t depth() const;
+        [[nodiscard]] std::size_t slot() const;
+        [[nodiscard]] MalType* fallback() const;
+        void trace() const override;
+        bool equal(const MalType *type) const override;
+        [[nodiscard]] std::size_t hash() const override;
+        [[nodiscard]] MalLocal* clone() const override;
+        void print(std::string& out, bool print_readably) const override;
 };
 
 class MalSequence : public MalStruct {
 protected:
-    std::vector<MalType*> elements_;
+    // Elements are not changed once a sequence is built, so the hash is computed once; 0 means not yet.
+    mutable std::size_t hash_ = 0;
 
     [[nodiscard]] std::vector<MalType*> elem_clone() const;
-    explicit MalSequence(std::vector<MalType*> elements);
-    MalSequence(std::initializer_list<MalType*> elements);
+    explicit MalSequence(MalKind kind);
     bool equal(const MalType* type) const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
 public:
-    std::vector<MalType*>& get_elem();
+    // Walks a sequence one contiguous chunk at a time, so list and vector storage iterate alike.
+    class const_iterator {
+        const MalSequence* sequence_ = nullptr;
+        std::size_t index_ = 0;
+        std::span<MalType* const> chunk_;
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = MalType*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = MalType* const*;
+        using reference = MalType* const&;
+
+        const_iterator() = default;
+        const_iterator(const MalSequence* sequence, std::size_t index);
+        reference operator*() const { return this->chunk_.front(); }
+        const_iterator& operator++();
+        const_iterator operator++(int);
+        bool operator==(const const_iterator& other) const { return this->index_ == other.index_; }
+    };
+
+    static bool classof(const MalType* type) {
+        return type->kind() == MalKind::List || type->kind() == MalKind::Vector;
+    }
+    [[nodiscard]] virtual std::size_t size() const = 0;
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] virtual MalType* nth(std::size_t index) const = 0;
+    // The elements from index to the end of the contiguous run holding it.
+    [[nodiscard]] virtual std::span<MalType* const> chunk(std::size_t index) const = 0;
+    [[nodiscard]] const_iterator begin() const;
+    [[nodiscard]] const_iterator end() const;
+    [[nodiscard]] std::vector<MalType*> to_vector() const;
+    [[nodiscard]] std::size_t hash() const override;
     [[nodiscard]] MalSequence* clone() const override = 0;
-    ~MalSequence() override;
+    ~MalSequence() override = default;
 };
 
 class MalPair final : public MalStruct {
     std::pair<MalType*, MalType*> data_;
 
 public:
+    static bool classof(const MalType* type) { return type->kind() == MalKind::Pair; }
     MalPair(MalType* key, MalType* value);
 
     [[nodiscard]] MalType* key() const;
     [[nodiscard]] MalType* value() const;
     void setValue(MalType* val);
+    void trace() const override;
     bool equal(const MalType* other) const override;
+    [[nodiscard]] std::size_t hash() const override;
     [[nodiscard]] MalPair* clone() const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
-    ~MalPair() override;
+};
+
+// Immutable element storage, shared by every list that views part of it.
+class ListChunk final : public GCObject {
+public:
+    std::vector<MalType*> values;
+
+    void trace() const override;
+    [[nodiscard]] std::size_t owned_bytes() const override;
 };
 
 class MalList final : public MalSequence {
+        // The elements are chunk_->values from begin_ on, then those of rest_. Lists built from a vector have
+        // no rest_; cons and rest share structure and are O(1), and get_elem() flattens a chain on first use.
+        mutable ListChunk* chunk_ = nullptr;
+        mutable std::size_t begin_ = 0;
+        mutable MalList* rest_ = nullptr;
+        std::size_t size_;
+        // Where the last chunk() walk stopped, so iterating does not restart from the head at every link.
+        mutable const MalList* cursor_ = nullptr;
+        mutable std::size_t cursor_index_ = 0;
+
+        MalList(ListChunk* chunk, std::size_t begin, MalList* rest);
+        [[nodiscard]] std::size_t own_size() const;
     public:
+        constexpr static std::size_t chunk_size = 32;
+
+        static bool classof(const MalType* type) { return type->kind() == MalKind::List; }
         explicit MalList(std::vector<MalType*> elements);
         MalList(std::initializer_list<MalType*> elements);
-        [[nodiscard]] std::string to_string(bool print_readably) const override;
+        // elements followed by rest, which is shared rather than copied.
+        MalList(std::vector<MalType*> elements, MalList* rest);
+        static MalList* cons(MalType* head, MalList* tail);
+        // The shared empty list, which like MalNil::instance() is never collected.
+        static MalList* empty_instance();
+        // Everything after the first element, sharing this list's storage: the next link when one element is left
+        // in the head chunk, otherwise a new view one slot further in, and the shared empty list at the end. Not
+        // cached, so a walk keeps no suffixes alive.
+        [[nodiscard]] MalList* rest() const;
+        [[nodiscard]] std::span<MalType* const> get_elem() const;
+        [[nodiscard]] std::size_t size() const override;
+        [[nodiscard]] MalType* nth(std::size_t index) const override;
+        [[nodiscard]] std::span<MalType* const> chunk(std::size_t index) const override;
+        void trace() const override;
         [[nodiscard]] MalList* clone() const override;
         ~MalList() override = default;
 };
 
 class MalVector final : public MalSequence {
+        PVector elements_;
     public:
-        explicit MalVector(std::vector<MalType*> elements);
+        static bool classof(const MalType* type) { return type->kind() == MalKind::Vector; }
+        explicit MalVector(std::span<MalType* const> elements);
         MalVector(std::initializer_list<MalType*> elements);
-        [[nodiscard]] std::string to_string(bool print_readably) const override;
+        explicit MalVector(const PVector& elements);
+        [[nodiscard]] const PVector& get_elem() const;
+        [[nodiscard]] std::size_t size() const override;
+        [[nodiscard]] MalType* nth(std::size_t index) const override;
+        [[nodiscard]] std::span<MalType* const> chunk(std::size_t index) const override;
+        // New vectors sharing all but one path with this one.
+        [[nodiscard]] MalVector* conj(MalType* value) const;
+        [[nodiscard]] MalVector* assoc(std::size_t index, MalType* value) const;
+        void trace() const override;
         [[nodiscard]] MalVector* clone() const override;
         ~MalVector() override = default;
 };
 
 class MalKeyword final : public MalAtom {
         std::string name_;
-    public:
+        std::size_t hash_;
+
         explicit MalKeyword(std::string name);
+    public:
+        static bool classof(const MalType* type) { return type->kind() == MalKind::Keyword; }
+        // Keywords are interned: one instance per name, never collected, so equality is identity.
+        static MalKeyword* intern(std::string_view name);
         [[nodiscard]] std::string name() const;
         bool equal(const MalType *type) const override;
-        [[nodiscard]] std::string to_string(bool print_readably) const override;
+        [[nodiscard]] std::size_t hash() const override;
+        void print(std::string& out, bool print_readably) const override;
         [[nodiscard]] MalKeyword* clone() const override;
         ~MalKeyword() override = default;
 };
 
 class MalMap final : public MalStruct {
-    std::set<MalPair*> elements_;
+    Hamt elements_;
+    mutable std::size_t hash_ = 0;
     public:
-    explicit MalMap(const std::set<MalPair*>& elements);
-    std::set<MalPair*>& get_elem();
+        static bool classof(const MalType* type) { return type->kind() == MalKind::Map; }
+    MalMap();
+    explicit MalMap(const Hamt& elements);
+    [[nodiscard]] const Hamt& get_elem() const;
+    [[nodiscard]] std::size_t size() const;
     MalType* get(MalType* key) const;
     void put(MalType* key, MalType* value);
+    [[nodiscard]] MalMap* assoc(MalType* key, MalType* value) const;
+    [[nodiscard]] MalMap* dissoc(MalType* key) const;
+    void trace() const override;
     bool equal(const MalType *type) const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
+    [[nodiscard]] std::size_t hash() const override;
     [[nodiscard]] MalMap* clone() const override;
-    ~MalMap() override;
 };
 
 class MalMetaData final : public MalType {
     MalMap* data_;
 public:
+    static bool classof(const MalType* type) { return type->kind() == MalKind::MetaData; }
     explicit MalMetaData(MalMap* map);
-    ~MalMetaData() override;
+    void trace() const override;
     bool equal(const MalType *type) const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
+    void print(std::string& out, bool print_readably) const override;
     [[nodiscard]] MalMetaData* clone() const override;
     MalMap* get_map();
     MalType* get(MalType* key);
@@ -190,90 +390,149 @@ public:
 class MalSyntaxQuote : public MalStruct {
 protected:
     MalType* expr_;
+
+    MalSyntaxQuote(MalKind kind, MalType* expr);
 public:
-    explicit MalSyntaxQuote(MalType* expr);
+    static bool classof(const MalType* type) {
+        return type->kind() >= MalKind::Quote && type->kind() <= MalKind::MetaSymbol;
+    }
     [[nodiscard]] MalType* get() const;
+    void trace() const override;
     [[nodiscard]] MalSyntaxQuote* clone() const override = 0;
-    ~MalSyntaxQuote() override;
 };
 
 class MalQuote final : public MalSyntaxQuote {
 public:
+    static bool classof(const MalType* type) { return type->kind() == MalKind::Quote; }
     explicit MalQuote(MalType* expr);
     bool equal(const MalType *type) const override;
     [[nodiscard]] MalQuote* clone() const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
 };
 
 class MalQuasiQuote final : public MalSyntaxQuote{
 public:
+    static bool classof(const MalType* type) { return type->kind() == MalKind::QuasiQuote; }
     explicit MalQuasiQuote(MalType* expr);
     bool equal(const MalType *type) const override;
     [[nodiscard]] MalQuasiQuote* clone() const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
 };
 
 class MalUnQuote final : public MalSyntaxQuote{
 public:
+    static bool classof(const MalType* type) { return type->kind() == MalKind::UnQuote; }
     explicit MalUnQuote(MalType* expr);
     bool equal(const MalType *type) const override;
     [[nodiscard]] MalUnQuote* clone() const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
 };
 
 class MalUnQuoteSplicing final : public MalSyntaxQuote{
 public:
+    static bool classof(const MalType* type) { return type->kind() == MalKind::UnQuoteSplicing; }
     explicit MalUnQuoteSplicing(MalType* expr);
     bool equal(const MalType *type) const override;
     [[nodiscard]] MalUnQuoteSplicing* clone() const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
 };
 
 class MalDeref final : public MalSyntaxQuote {
 public:
+    static bool classof(const MalType* type) { return type->kind() == MalKind::Deref; }
     explicit MalDeref(MalType* expr);
     bool equal(const MalType *type) const override;
     [[nodiscard]] MalDeref* clone() const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
 };
 
 class MalMetaSymbol final : public MalSyntaxQuote {
     MalType* meta_;
     MalType* value_;
 public:
+    static bool classof(const MalType* type) { return type->kind() == MalKind::MetaSymbol; }
     explicit MalMetaSymbol(MalType* meta, MalType* value);
     [[nodiscard]] MalType* get_meta() const;
     [[nodiscard]] MalType* get_value() const;
+    void trace() const override;
     bool equal(const MalType *type) const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
+    [[nodiscard]] std::size_t hash() const override;
     [[nodiscard]] MalMetaSymbol* clone() const override;
-    ~MalMetaSymbol() override;
+};
+
+enum class Primitive : uint8_t {
+    None,
+    Add,
+    Sub,
+    Mul,
+    Eq,
+    Lt,
+    Le,
+    Gt,
+    Ge,
+};
+
+// How a closure binds its arguments, worked out once from its parameter list. Parameters live in slots
+// resolved by the analyzer, so a call only needs the counts.
+struct ParamBinding {
+    std::size_t fixed_arity = 0;
+    bool variadic = false;
+
+    // Validates a fn* parameter list; throws on anything but symbols with at most one trailing `& rest`.
+    static ParamBinding compile(const MalSequence* params);
+    // Throws unless a call with this many arguments can be bound.
+    void check_arity(std::size_t count) const;
 };
 
 class MalFunction final : public MalType {
 public:
-    using mal_func_args_list_type = const std::vector<MalType*>;
-    using mal_func_return_type = MalType*;
-    using mal_func_type = mal_func_return_type(mal_func_args_list_type);
+    static bool classof(const MalType* type) { return type->kind() == MalKind::Function; }
+    using mal_func_args_list_type = std::span<MalType* const>;
 private:
-    std::function<mal_func_type> func_;
-    bool is_builtin;
+    const Builtin* builtin_;
     MalSequence* args_list;
+    ParamBinding binding_;
     MalType* body_;
     Env* env_;
+    Chunk* chunk_;
 
 public:
-    explicit MalFunction(std::function<mal_func_type> fn);
-    explicit MalFunction(MalSequence* args, MalType* body, Env* env);
+    explicit MalFunction(const Builtin* builtin);
+    MalFunction(MalSequence* args, const ParamBinding& binding, MalType* body, Env* env);
+    // A closure over env. The parameter list is compiled first, so a bad one throws before anything is allocated.
+    static MalFunction* closure(MalSequence* args, MalType* body, Env* env);
     [[nodiscard]] MalSequence* get_args_list() const;
     [[nodiscard]] MalType* get_body() const;
     [[nodiscard]] Env* get_env() const;
     [[nodiscard]] bool is_builtin_func() const;
-    MalType* operator()(mal_func_args_list_type& params) const;
-    [[nodiscard]] MalType* apply(mal_func_args_list_type& args) const;
+    [[nodiscard]] Primitive primitive() const;
+    [[nodiscard]] Chunk* get_chunk() const;
+    void set_chunk(Chunk* chunk);
+    [[nodiscard]] const ParamBinding& binding() const;
+    [[nodiscard]] Env* make_env(mal_func_args_list_type params) const;
+    [[nodiscard]] Env* make_env(std::span<const Value> params) const;
+    MalType* operator()(mal_func_args_list_type params) const;
+    [[nodiscard]] MalType* apply(mal_func_args_list_type args) const;
+    void trace() const override;
     bool equal(const MalType *type) const override;
     [[nodiscard]] MalFunction* clone() const override;
-    [[nodiscard]] std::string to_string(bool print_readably) const override;
+    void print(std::string& out, bool print_readably) const override;
 };
 
+// LLVM-style casts over MalType::kind(). Unlike LLVM, isa<> and dyn_cast<> accept null just like the
+// dynamic_cast they replace; cast<> asserts that the kind matches.
+template <typename To, typename From>
+using cast_result_t = std::conditional_t<std::is_const_v<From>, const To*, To*>;
+
+template <typename To, typename From>
+bool isa(From* value) {
+    return value && To::classof(value);
+}
+
+template <typename To, typename From>
+cast_result_t<To, From> cast(From* value) {
+    assert(isa<To>(value));
+    return static_cast<cast_result_t<To, From>>(value);
+}
+
+template <typename To, typename From>
+cast_result_t<To, From> dyn_cast(From* value) {
+    return isa<To>(value) ? static_cast<cast_result_t<To, From>>(value) : nullptr;
+}
+
 #endif //TYPES_H
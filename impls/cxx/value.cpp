@@ -0,0 +1,42 @@
+#include "value.h"
+#include "types.h"
+#include "evaluator.h"
+
+Value Value::integer(const int64_t n) {
+    return fits_fixnum(n) ? fixnum(n) : object(new MalInt(n));
+}
+
+Value Value::literal(MalType* obj) {
+    switch (obj->kind()) {
+        case MalKind::Int: {
+            const int64_t n = cast<MalInt>(obj)->get_elem();
+            return fits_fixnum(n) ? fixnum(n) : object(obj);
+        }
+        case MalKind::Nil:
+            return nil();
+        case MalKind::Bool:
+            return boolean(cast<MalBool>(obj)->get_elem());
+        default:
+            return object(obj);
+    }
+}
+
+bool Value::truthy() const {
+    if (this->is_immediate()) {
+        return this->bits_ == true_bits;
+    }
+    return this->is_fixnum() || Evaluator::truthy(this->as_object());
+}
+
+MalType* Value::box() const {
+    if (this->is_fixnum()) {
+        return MalInt::of(this->as_fixnum());
+    }
+    if (this->bits_ == nil_bits) {
+        return MalNil::instance();
+    }
+    if (this->is_immediate()) {
+        return MalBool::instance(this->bits_ == true_bits);
+    }
+    return this->as_object();
+}
@@ -0,0 +1,71 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <cstdint>
+#include <limits>
+
+class MalType;
+
+// A tagged 64-bit word: heap objects keep their pointer, small integers, nil and booleans are stored inline.
+class Value {
+    uintptr_t bits_;
+
+    static constexpr uintptr_t tag_mask = 0b11;
+    static constexpr uintptr_t fixnum_tag = 0b01;
+    static constexpr uintptr_t immediate_tag = 0b10;
+    static constexpr uintptr_t nil_bits = 0b0010;
+    static constexpr uintptr_t false_bits = 0b0110;
+    static constexpr uintptr_t true_bits = 0b1010;
+
+    constexpr explicit Value(const uintptr_t bits) : bits_(bits) {}
+public:
+    static constexpr int64_t fixnum_min = std::numeric_limits<int64_t>::min() >> 2;
+    static constexpr int64_t fixnum_max = std::numeric_limits<int64_t>::max() >> 2;
+
+    constexpr Value() : bits_(0) {}
+
+    static Value object(MalType* obj) {
+        return Value(reinterpret_cast<uintptr_t>(obj));
+    }
+    static constexpr bool fits_fixnum(const int64_t n) {
+        return n >= fixnum_min && n <= fixnum_max;
+    }
+    static constexpr Value fixnum(const int64_t n) {
+        return Value(static_cast<uintptr_t>(n) << 2 | fixnum_tag);
+    }
+    static constexpr Value nil() {
+        return Value(nil_bits);
+    }
+    static constexpr Value boolean(const bool b) {
+        return Value(b ? true_bits : false_bits);
+    }
+    static Value integer(int64_t n);
+    static Value literal(MalType* obj);
+
+    [[nodiscard]] constexpr bool is_null() const {
+        return this->bits_ == 0;
+    }
+    [[nodiscard]] constexpr bool is_object() const {
+        return this->bits_ != 0 && (this->bits_ & tag_mask) == 0;
+    }
+    [[nodiscard]] constexpr bool is_fixnum() const {
+        return (this->bits_ & tag_mask) == fixnum_tag;
+    }
+    [[nodiscard]] constexpr bool is_immediate() const {
+        return (this->bits_ & tag_mask) == immediate_tag;
+    }
+    [[nodiscard]] MalType* as_object() const {
+        return reinterpret_cast<MalType*>(this->bits_);
+    }
+    [[nodiscard]] constexpr int64_t as_fixnum() const {
+        return static_cast<int64_t>(this->bits_) >> 2;
+    }
+    [[nodiscard]] bool truthy() const;
+    [[nodiscard]] MalType* box() const;
+
+    constexpr bool operator==(const Value& other) const = default;
+};
+
+static_assert(sizeof(Value) == sizeof(int64_t));
+
+#endif //VALUE_H
@@ -0,0 +1,710 @@
+#include "vm.h"
+#include <type_traits>
+#include "env.h"
+#include "error.h"
+#include "evaluator.h"
+
+#if defined(__GNUC__)
+#define MAL_VM_COMPUTED_GOTO 1
+#else
+#define MAL_VM_COMPUTED_GOTO 0
+#endif
+
+void Chunk::trace() const {
+    for (const auto constant: this->constants) {
+        if (constant.is_object()) {
+            GC::mark(constant.as_object());
+        }
+    }
+    for (const auto proto: this->protos) {
+        GC::mark(proto);
+    }
+}
+
+namespace {
+    Primitive primitive_for(const Symbol* name) {
+        static const std::pair<const Symbol*, Primitive> primitives[] = {
+            {SymbolTable::intern("+"), Primitive::Add},
+            {SymbolTable::intern("-"), Primitive::Sub},
+            {SymbolTable::intern("*"), Primitive::Mul},
+            {SymbolTable::intern("="), Primitive::Eq},
+            {SymbolTable::intern("<"), Primitive::Lt},
+            {SymbolTable::intern("<="), Primitive::Le},
+            {SymbolTable::intern(">"), Primitive::Gt},
+            {SymbolTable::intern(">="), Primitive::Ge},
+        };
+        for (const auto& [symbol, primitive]: primitives) {
+            if (symbol == name) {
+                return primitive;
+            }
+        }
+        return Primitive::None;
+    }
+
+    bool int_operand(const Value value, int64_t& out) {
+        if (value.is_fixnum()) {
+            out = value.as_fixnum();
+            return true;
+        }
+        if (const auto num = value.is_object() ? dyn_cast<MalInt>(value.as_object()) : nullptr) {
+            out = num->get_elem();
+            return true;
+        }
+        return false;
+    }
+
+    // Computes a primitive on inline operands. Anything unusual (non-integers, possible overflow, and the
+    // builtin's own error cases) returns false so the caller goes through the real builtin instead.
+    bool apply_primitive(const Primitive primitive, const Value lhs, const Value rhs, Value& result) {
+        if (primitive == Primitive::Eq && lhs.is_immediate() && rhs.is_immediate()) {
+            result = Value::boolean(lhs == rhs);
+            return true;
+        }
+        int64_t a, b;
+        if (!int_operand(lhs, a) || !int_operand(rhs, b)) {
+            return false;
+        }
+        constexpr int64_t mul_limit = int64_t{1} << 31;
+        switch (primitive) {
+            case Primitive::Add:
+                if (!Value::fits_fixnum(a) || !Value::fits_fixnum(b)) return false;
+                result = Value::integer(a + b);
+                return true;
+            case Primitive::Sub:
+                if (!Value::fits_fixnum(a) || !Value::fits_fixnum(b) || b == 0) return false;
+                result = Value::integer(a - b);
+                return true;
+            case Primitive::Mul:
+                if (a <= -mul_limit || a >= mul_limit || b <= -mul_limit || b >= mul_limit) return false;
+                result = Value::integer(a * b);
+                return true;
+            case Primitive::Eq:
+                result = Value::boolean(a == b);
+                return true;
+            case Primitive::Lt:
+                result = Value::boolean(a < b);
+                return true;
+            case Primitive::Le:
+                result = Value::boolean(a <= b);
+                return true;
+            case Primitive::Gt:
+                result = Value::boolean(a > b);
+                return true;
+            case Primitive::Ge:
+                result = Value::boolean(a >= b);
+                return true;
+            case Primitive::None:
+                break;
+        }
+        return false;
+    }
+}
+
+Compiler::Compiler(Chunk* chunk) : chunk_(chunk) {}
+
+Chunk* Compiler::compile(MalType* body) {
+    const auto chunk = new Chunk;
+    Compiler compiler(chunk);
+    compiler.compile(body, true);
+    compiler.emit(Op::Return);
+    return chunk;
+}
+
+int32_t Compiler::constant(const Value value) {
+    this->chunk_->constants.push_back(value);
+    return static_cast<int32_t>(this->chunk_->constants.size() - 1);
+}
+
+int32_t Compiler::constant(MalType* value) {
+    return this->constant(Value::object(value));
+}
+
+int32_t Compiler::literal(MalType* value) {
+    return this->constant(Value::literal(value));
+}
+
+void Compiler::emit(const Op op) {
+    this->chunk_->code.push_back(static_cast<int32_t>(op));
+}
+
+void Compiler::emit(const Op op, const int32_t operand) {
+    this->emit(op);
+    this->chunk_->code.push_back(operand);
+}
+
+void Compiler::emit(const Op op, const int32_t first, const int32_t second) {
+    this->emit(op, first);
+    this->chunk_->code.push_back(second);
+}
+
+std::size_t Compiler::emit_jump(const Op op) {
+    this->emit(op, 0);
+    return this->chunk_->code.size() - 1;
+}
+
+void Compiler::patch_jump(const std::size_t operand) {
+    this->chunk_->code[operand] = static_cast<int32_t>(this->chunk_->code.size());
+}
+
+void Compiler::compile(MalType* form, const bool tail) {
+    switch (form->kind()) {
+        case MalKind::Local:
+            this->emit(Op::LoadLocal, this->constant(form));
+            return;
+
+        case MalKind::Symbol:
+            this->emit(Op::LoadGlobal, this->constant(form));
+            return;
+
+        case MalKind::List: {
+            const auto list = cast<MalList>(form);
+            if (list->get_elem().empty()) {
+                this->emit(Op::Const, this->constant(list));
+            } else {
+                this->compile_list(list, tail);
+            }
+            return;
+        }
+
+        case MalKind::Vector: {
+            const auto vec = cast<MalVector>(form);
+            for (const auto elem: *vec) {
+                this->compile(elem, false);
+            }
+            this->emit(Op::MakeVector, static_cast<int32_t>(vec->size()));
+            return;
+        }
+
+        case MalKind::Map: {
+            const auto map = cast<MalMap>(form);
+            for (const auto pair: map->get_elem()) {
+                this->compile(pair->value(), false);
+            }
+            this->emit(Op::MakeMap, this->constant(map));
+            return;
+        }
+
+        case MalKind::Deref:
+            this->compile(cast<MalDeref>(form)->get(), false);
+            this->emit(Op::Deref);
+            return;
+
+        case MalKind::Quote:
+            this->emit(Op::Const, this->constant(cast<MalQuote>(form)->get()));
+            return;
+
+        case MalKind::QuasiQuote:
+            this->compile(Evaluator::quasiquote(cast<MalQuasiQuote>(form)->get()), tail);
+            return;
+
+        default:
+            this->emit(Op::Const, this->literal(form));
+            return;
+    }
+}
+
+void Compiler::compile_list(MalList* form, const bool tail) {
+    const auto& elems = form->get_elem();
+    const auto head = dyn_cast<MalSymbol>(elems[0]);
+    bool compiled = true;
+    switch (head ? head->special() : SpecialForm::None) {
+        case SpecialForm::Fn:
+            compiled = this->compile_fn(form);
+            break;
+        case SpecialForm::Do:
+            this->compile_do(form, tail);
+            break;
+        case SpecialForm::If:
+            compiled = this->compile_if(form, tail);
+            break;
+        case SpecialForm::Def:
+            compiled = this->compile_def(form);
+            break;
+        case SpecialForm::Let:
+            compiled = this->compile_let(form, tail);
+            break;
+        case SpecialForm::Quote:
+            compiled = elems.size() == 2;
+            if (compiled) {
+                this->emit(Op::Const, this->constant(elems[1]));
+            }
+            break;
+        case SpecialForm::QuasiQuote:
+            compiled = elems.size() == 2;
+            if (compiled) {
+                this->emit(Op::Const, this->constant(Evaluator::quasiquote(elems[1])));
+            }
+            break;
+        case SpecialForm::UnQuote:
+            compiled = elems.size() == 2;
+            if (compiled) {
+                this->emit(Op::Const, this->constant(new MalUnQuote(elems[1])));
+            }
+            break;
+        case SpecialForm::SpliceUnQuote:
+            compiled = elems.size() >= 2;
+            if (compiled) {
+                this->emit(Op::Const, this->constant(new MalUnQuoteSplicing(elems[1])));
+            }
+            break;
+        case SpecialForm::None:
+            this->compile_call(form, tail);
+            break;
+    }
+    // Malformed special forms are left to the tree-walker so they raise the same errors at the same time.
+    if (!compiled) {
+        this->emit(Op::Exec, this->constant(form));
+    }
+}
+
+bool Compiler::compile_fn(MalList* form) {
+    const auto& elems = form->get_elem();
+    if (elems.size() != 3) {
+        return false;
+    }
+    const auto args_list = dyn_cast<MalSequence>(elems[1]);
+    if (!args_list) {
+        return false;
+    }
+    for (const auto arg: *args_list) {
+        if (!isa<MalSymbol>(arg)) {
+            return false;
+        }
+    }
+    this->chunk_->protos.push_back(compile(elems[2]));
+    this->emit(Op::Closure, this->constant(form), static_cast<int32_t>(this->chunk_->protos.size() - 1));
+    return true;
+}
+
+void Compiler::compile_do(MalList* form, const bool tail) {
+    const auto& elems = form->get_elem();
+    if (elems.size() == 1) {
+        this->emit(Op::Const, this->constant(Value::nil()));
+        return;
+    }
+    for (std::size_t i = 1; i < elems.size() - 1; ++i) {
+        this->compile(elems[i], false);
+        this->emit(Op::Pop);
+    }
+    this->compile(elems.back(), tail);
+}
+
+bool Compiler::compile_if(MalList* form, const bool tail) {
+    const auto& elems = form->get_elem();
+    if (elems.size() != 3 && elems.size() != 4) {
+        return false;
+    }
+    this->compile(elems[1], false);
+    const auto else_jump = this->emit_jump(Op::JumpIfFalse);
+    this->compile(elems[2], tail);
+    const auto end_jump = this->emit_jump(Op::Jump);
+    this->patch_jump(else_jump);
+    if (elems.size() == 4) {
+        this->compile(elems[3], tail);
+    } else {
+        this->emit(Op::Const, this->constant(Value::nil()));
+    }
+    this->patch_jump(end_jump);
+    return true;
+}
+
+bool Compiler::compile_def(MalList* form) {
+    const auto& elems = form->get_elem();
+    if (elems.size() != 3) {
+        return false;
+    }
+    if (const auto local = dyn_cast<MalLocal>(elems[1])) {
+        this->compile(elems[2], false);
+        this->emit(Op::SetLocal, static_cast<int32_t>(local->slot()));
+        return true;
+    }
+    if (isa<MalSymbol>(elems[1])) {
+        this->compile(elems[2], false);
+        this->emit(Op::DefName, this->constant(elems[1]));
+        return true;
+    }
+    return false;
+}
+
+bool Compiler::compile_let(MalList* form, const bool tail) {
+    const auto& elems = form->get_elem();
+    if (elems.size() != 3) {
+        return false;
+    }
+    const auto bindings = dyn_cast<MalSequence>(elems[1]);
+    if (!bindings || bindings->size() % 2 != 0) {
+        return false;
+    }
+    // Only slot bindings are compiled; a by-name binding is DEBUG-EVAL, whose tracing lives in the tree-walker.
+    const auto binding_elems = bindings->to_vector();
+    for (std::size_t i = 0; i < binding_elems.size(); i += 2) {
+        if (!isa<MalLocal>(binding_elems[i])) {
+            return false;
+        }
+    }
+
+    this->emit(Op::EnterLet);
+    for (std::size_t i = 0; i < binding_elems.size(); i += 2) {
+        this->compile(binding_elems[i + 1], false);
+        this->emit(Op::BindLocal, static_cast<int32_t>(cast<MalLocal>(binding_elems[i])->slot()));
+    }
+    this->compile(elems[2], tail);
+    if (!tail) {
+        this->emit(Op::LeaveLet);
+    }
+    return true;
+}
+
+void Compiler::compile_call(MalList* form, const bool tail) {
+    const auto& elems = form->get_elem();
+    if (const auto head = dyn_cast<MalSymbol>(elems[0]); head && elems.size() == 3) {
+        if (const auto primitive = primitive_for(head->id()); primitive != Primitive::None) {
+            this->compile(elems[1], false);
+            this->compile(elems[2], false);
+            this->emit(Op::Prim, static_cast<int32_t>(primitive), this->constant(head));
+            return;
+        }
+    }
+    for (const auto elem: elems) {
+        this->compile(elem, false);
+    }
+    this->emit(tail ? Op::TailCall : Op::Call, static_cast<int32_t>(elems.size() - 1));
+}
+
+namespace {
+    struct Frame {
+        Chunk* chunk;
+        std::size_t ip;
+        Env* env;
+        std::size_t stack_base;
+        std::size_t env_base;
+    };
+
+    class VMState final : public GCRootSet {
+    public:
+        std::vector<Value> stack;
+        std::vector<Frame> frames;
+        std::vector<Env*> saved_envs;
+
+        void trace() const override {
+            for (const auto value: this->stack) {
+                if (value.is_object()) {
+                    GC::mark(value.as_object());
+                }
+            }
+            for (const auto& frame: this->frames) {
+                GC::mark(frame.chunk);
+                GC::mark(frame.env);
+            }
+            for (const auto env: this->saved_envs) {
+                GC::mark(env);
+            }
+        }
+    };
+}
+
+Chunk* VM::chunk_for(MalFunction* fn) {
+    if (!fn->get_chunk()) {
+        fn->set_chunk(Compiler::compile(fn->get_body()));
+    }
+    return fn->get_chunk();
+}
+
+Value VM::load_local(const MalLocal* local, Env* env) {
+    while (true) {
+        if (const Value value = env->get_value(local->depth(), local->slot()); !value.is_null()) {
+            return value;
+        }
+        const auto fallback = local->fallback();
+        if (!fallback) {
+            throw typeError("'" + local->symbol()->name() + "'" + " not found.");
+        }
+        if (const auto next = dyn_cast<MalLocal>(fallback)) {
+            local = next;
+            continue;
+        }
+        const auto sym = static_cast<MalSymbol*>(fallback);
+        MalType* value = env->get(sym->id());
+        if (!value) {
+            throw typeError("'" + sym->name() + "'" + " not found.");
+        }
+        return Value::object(value);
+    }
+}
+
+MalType* VM::run(MalType* form, Env* env) {
+    if (Evaluator::debug_eval_enabled(env)) {
+        return Evaluator::exec(form, env);
+    }
+    return run(Compiler::compile(form), env);
+}
+
+MalType* VM::run(Chunk* chunk, Env* env) {
+    DebugEvalScope debug_eval;
+    VMState state;
+    GCRootScope roots;
+    GC::add_root(&state);
+
+    auto& stack = state.stack;
+    auto& frames = state.frames;
+    auto& saved_envs = state.saved_envs;
+    frames.push_back({chunk, 0, env, 0, 0});
+
+    const int32_t* code = chunk->code.data();
+    const Value* constants = chunk->constants.data();
+    std::size_t ip = 0;
+    std::size_t argc = 0;
+    bool tail = false;
+
+    // VM_DISPATCH() leaves an op body differently on the two paths. The switch fallback's continue runs the
+    // destructors of the body's locals like any scope exit; the threaded path's computed goto jumps straight to
+    // the next op and runs none of them. So an op body must not hold a local with a destructor when it
+    // dispatches: keep such objects in an inner block that closes first, as MakeVector and call do with ArgFrame.
+    // The locals op bodies do keep across dispatch are checked here.
+    static_assert(std::is_trivially_destructible_v<Value> && std::is_trivially_destructible_v<Frame> &&
+                  std::is_trivially_destructible_v<Hamt> && std::is_trivially_destructible_v<Hamt::const_iterator>);
+#if MAL_VM_COMPUTED_GOTO
+    static void* const dispatch_table[] = {
+        &&op_Const, &&op_LoadLocal, &&op_LoadGlobal, &&op_SetLocal, &&op_DefName, &&op_BindLocal,
+        &&op_EnterLet, &&op_LeaveLet, &&op_Pop, &&op_Jump, &&op_JumpIfFalse, &&op_Closure,
+        &&op_Call, &&op_TailCall, &&op_Prim, &&op_Return, &&op_MakeVector, &&op_MakeMap, &&op_Deref, &&op_Exec,
+    };
+    static_assert(std::size(dispatch_table) == static_cast<std::size_t>(Op::Exec) + 1);
+#define VM_CASE(name) op_##name
+#define VM_DISPATCH() goto *dispatch_table[code[ip++]]
+    VM_DISPATCH();
+#else
+#define VM_CASE(name) case Op::name
+#define VM_DISPATCH() continue
+    while (true) {
+    switch (static_cast<Op>(code[ip++])) {
+#endif
+
+    VM_CASE(Const): {
+        stack.push_back(constants[code[ip++]]);
+        VM_DISPATCH();
+    }
+
+    VM_CASE(LoadLocal): {
+        const auto local = static_cast<MalLocal*>(constants[code[ip++]].as_object());
+        stack.push_back(load_local(local, env));
+        VM_DISPATCH();
+    }
+
+    VM_CASE(LoadGlobal): {
+        const auto sym = static_cast<MalSymbol*>(constants[code[ip++]].as_object());
+        MalType* value = env->get(sym->id());
+        if (!value) {
+            throw typeError("'" + sym->name() + "'" + " not found.");
+        }
+        stack.push_back(Value::object(value));
+        VM_DISPATCH();
+    }
+
+    VM_CASE(SetLocal): {
+        env->set_value(static_cast<std::size_t>(code[ip++]), stack.back());
+        VM_DISPATCH();
+    }
+
+    VM_CASE(DefName): {
+        const auto sym = static_cast<MalSymbol*>(constants[code[ip++]].as_object());
+        MalType* value = stack.back().box();
+        stack.back() = Value::object(value);
+        Evaluator::bind(env, sym, value);
+        VM_DISPATCH();
+    }
+
+    VM_CASE(BindLocal): {
+        env->set_value(static_cast<std::size_t>(code[ip++]), stack.back());
+        stack.pop_back();
+        VM_DISPATCH();
+    }
+
+    VM_CASE(EnterLet): {
+        saved_envs.push_back(env);
+        env = new Env(env, false);
+        frames.back().env = env;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(LeaveLet): {
+        env = saved_envs.back();
+        saved_envs.pop_back();
+        frames.back().env = env;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(Pop): {
+        stack.pop_back();
+        VM_DISPATCH();
+    }
+
+    VM_CASE(Jump): {
+        ip = static_cast<std::size_t>(code[ip]);
+        VM_DISPATCH();
+    }
+
+    VM_CASE(JumpIfFalse): {
+        const bool truthy = stack.back().truthy();
+        stack.pop_back();
+        ip = truthy ? ip + 1 : static_cast<std::size_t>(code[ip]);
+        VM_DISPATCH();
+    }
+
+    VM_CASE(Closure): {
+        const auto& form = static_cast<MalList*>(constants[code[ip++]].as_object())->get_elem();
+        const auto fn = MalFunction::closure(static_cast<MalSequence*>(form[1]), form[2], env);
+        fn->set_chunk(frames.back().chunk->protos[code[ip++]]);
+        stack.push_back(Value::object(fn));
+        VM_DISPATCH();
+    }
+
+    VM_CASE(Call): {
+        argc = static_cast<std::size_t>(code[ip++]);
+        tail = false;
+        goto call;
+    }
+
+    VM_CASE(TailCall): {
+        argc = static_cast<std::size_t>(code[ip++]);
+        tail = true;
+        goto call;
+    }
+
+    VM_CASE(Prim): {
+        const auto primitive = static_cast<Primitive>(code[ip++]);
+        const auto sym = static_cast<MalSymbol*>(constants[code[ip++]].as_object());
+        MalType* head = env->get(sym->id());
+        if (!head) {
+            throw typeError("'" + sym->name() + "'" + " not found.");
+        }
+        if (const auto fn = dyn_cast<MalFunction>(head); fn && fn->primitive() == primitive) {
+            if (Value result; apply_primitive(primitive, stack.end()[-2], stack.back(), result)) {
+                stack.pop_back();
+                stack.back() = result;
+                VM_DISPATCH();
+            }
+        }
+        stack.insert(stack.end() - 2, Value::object(head));
+        argc = 2;
+        tail = false;
+        goto call;
+    }
+
+    VM_CASE(Return): {
+        const Value result = stack.back();
+        const Frame frame = frames.back();
+        frames.pop_back();
+        stack.resize(frame.stack_base);
+        saved_envs.resize(frame.env_base);
+        if (frames.empty()) {
+            return result.box();
+        }
+        stack.push_back(result);
+        code = frames.back().chunk->code.data();
+        constants = frames.back().chunk->constants.data();
+        ip = frames.back().ip;
+        env = frames.back().env;
+        VM_DISPATCH();
+    }
+
+    VM_CASE(MakeVector): {
+        const auto count = static_cast<std::size_t>(code[ip++]);
+        const auto first = stack.end() - static_cast<std::ptrdiff_t>(count);
+        MalVector* vec;
+        {
+            const ArgFrame frame(count);
+            const auto elems = frame.slots();
+            for (std::size_t i = 0; i < count; ++i) {
+                elems[i] = first[static_cast<std::ptrdiff_t>(i)].box();
+            }
+            vec = new MalVector(elems);
+        }
+        stack.erase(first, stack.end());
+        stack.push_back(Value::object(vec));
+        VM_DISPATCH();
+    }
+
+    VM_CASE(MakeMap): {
+        const auto map = static_cast<MalMap*>(constants[code[ip++]].as_object());
+        const auto first = stack.end() - static_cast<std::ptrdiff_t>(map->size());
+        for (auto it = first; it != stack.end(); ++it) {
+            *it = Value::object(it->box());
+        }
+        auto value = first;
+        Hamt pairs;
+        for (const auto pair: map->get_elem()) {
+            pairs = pairs.assoc(new MalPair{pair->key(), (value++)->as_object()});
+        }
+        const auto result = new MalMap(pairs);
+        stack.erase(first, stack.end());
+        stack.push_back(Value::object(result));
+        VM_DISPATCH();
+    }
+
+    VM_CASE(Deref): {
+        const auto ref = stack.back().is_object() ? dyn_cast<MalRef>(stack.back().as_object()) : nullptr;
+        if (!ref) {
+            throw valueError("Cannot deref a non-atom type");
+        }
+        stack.back() = Value::object(Evaluator::exec(ref->get(), env));
+        VM_DISPATCH();
+    }
+
+    VM_CASE(Exec): {
+        stack.push_back(Value::object(Evaluator::exec(constants[code[ip++]].as_object(), env)));
+        VM_DISPATCH();
+    }
+
+    call: {
+        GC::safepoint();
+        const auto callee_at = stack.size() - argc - 1;
+        const Value callee_value = stack[callee_at];
+        const auto fn = callee_value.is_object() ? dyn_cast<MalFunction>(callee_value.as_object()) : nullptr;
+        if (!fn) {
+            throw typeError(callee_value.box()->to_string(true) + " is not a function");
+        }
+        const std::span<const Value> args(stack.data() + callee_at + 1, argc);
+        if (fn->is_builtin_func()) {
+            // Builtins take heap values; the boxed arguments go in a frame on the shared argument stack, which
+            // closes before dispatch jumps on.
+            MalType* result;
+            {
+                const ArgFrame frame(argc);
+                const auto boxed = frame.slots();
+                for (std::size_t i = 0; i < argc; ++i) {
+                    boxed[i] = args[i].box();
+                }
+                result = fn->apply(boxed);
+            }
+            stack.resize(callee_at);
+            stack.push_back(Value::object(result));
+            VM_DISPATCH();
+        }
+
+        Env* callee_env = fn->make_env(args);
+        Chunk* callee = chunk_for(fn);
+        if (tail) {
+            stack.resize(frames.back().stack_base);
+            saved_envs.resize(frames.back().env_base);
+            frames.back() = {callee, 0, callee_env, stack.size(), saved_envs.size()};
+        } else {
+            stack.resize(callee_at);
+            frames.back().ip = ip;
+            frames.push_back({callee, 0, callee_env, stack.size(), saved_envs.size()});
+        }
+        code = callee->code.data();
+        constants = callee->constants.data();
+        ip = 0;
+        env = callee_env;
+        VM_DISPATCH();
+    }
+
+#if !MAL_VM_COMPUTED_GOTO
+    }
+    }
+#endif
+
+#undef VM_CASE
+#undef VM_DISPATCH
+}
@@ -0,0 +1,74 @@
+#ifndef VM_H
+#define VM_H
+
+#include <cstdint>
+#include <vector>
+#include "gc.h"
+#include "types.h"
+#include "value.h"
+
+enum class Op : int32_t {
+    Const,
+    LoadLocal,
+    LoadGlobal,
+    SetLocal,
+    DefName,
+    BindLocal,
+    EnterLet,
+    LeaveLet,
+    Pop,
+    Jump,
+    JumpIfFalse,
+    Closure,
+    Call,
+    TailCall,
+    Prim,
+    Return,
+    MakeVector,
+    MakeMap,
+    Deref,
+    Exec,
+};
+
+class Chunk final : public GCObject {
+public:
+    std::vector<int32_t> code;
+    std::vector<Value> constants;
+    std::vector<Chunk*> protos;
+
+    void trace() const override;
+};
+
+class Compiler {
+    Chunk* chunk_;
+
+    explicit Compiler(Chunk* chunk);
+    int32_t constant(Value value);
+    int32_t constant(MalType* value);
+    int32_t literal(MalType* value);
+    void emit(Op op);
+    void emit(Op op, int32_t operand);
+    void emit(Op op, int32_t first, int32_t second);
+    std::size_t emit_jump(Op op);
+    void patch_jump(std::size_t operand);
+    void compile(MalType* form, bool tail);
+    void compile_list(MalList* form, bool tail);
+    bool compile_fn(MalList* form);
+    bool compile_let(MalList* form, bool tail);
+    bool compile_def(MalList* form);
+    bool compile_if(MalList* form, bool tail);
+    void compile_do(MalList* form, bool tail);
+    void compile_call(MalList* form, bool tail);
+public:
+    static Chunk* compile(MalType* body);
+};
+
+class VM {
+    static Chunk* chunk_for(MalFunction* fn);
+    static Value load_local(const MalLocal* local, Env* env);
+public:
+    static MalType* run(MalType* form, Env* env);
+    static MalType* run(Chunk* chunk, Env* env);
+};
+
+#endif //VM_H